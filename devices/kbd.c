@@ -6,6 +6,9 @@
 #include "devices/input.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#ifdef HEAPPROF
+#include "threads/heapprof.h"
+#endif
 
 /* Keyboard data register port. */
 #define DATA_REG 0x60
@@ -115,6 +118,12 @@ keyboard_interrupt (struct intr_frame *args UNUSED) {
 		/* Caps Lock. */
 		if (!release)
 			caps_lock = !caps_lock;
+#ifdef HEAPPROF
+	} else if (code == 0x58) {
+		/* F12 dumps the kernel heap profile. */
+		if (!release)
+			heapprof_dump ();
+#endif
 	} else if (map_key (invariant_keymap, code, &c)
 			|| (!shift && map_key (unshifted_keymap, code, &c))
 			|| (shift && map_key (shifted_keymap, code, &c))) {
@@ -3,12 +3,16 @@
 #include "filesys/filesys.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 
 /* Project 4 -------------------------- */
 #include "include/lib/kernel/bitmap.h"
 
+static struct fat_fs *fat_fs;
+
 void fat_boot_create(void);
 void fat_fs_init(void);
 
@@ -256,3 +260,21 @@ cluster_to_sector(cluster_t clst)
 	/* N번 클러스터가 디스크 상의 몇 번째 섹터인지를 계산 */
 	return fat_fs->data_start + (clst - 1) * SECTORS_PER_CLUSTER;
 }
+
+/* Covert a sector # to a cluster number. */
+cluster_t
+sector_to_cluster(disk_sector_t sector)
+{
+	ASSERT(sector >= fat_fs->data_start);
+
+	return sector - fat_fs->data_start + 1;
+}
+
+/* Returns the number of pages the in-memory FAT takes, or 0 if no
+ * FAT is loaded. */
+size_t fat_memory_pages(void)
+{
+	if (fat_fs == NULL || fat_fs->fat == NULL)
+		return 0;
+	return DIV_ROUND_UP(fat_fs->fat_length * sizeof(cluster_t), PGSIZE);
+}
@@ -89,6 +89,17 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) {
 	return inode_read_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads SIZE bytes from FILE into the page-sized buffers in PAGES,
+ * one after another, starting at offset FILE_OFS in the file, which
+ * must be a multiple of the disk sector size.
+ * Returns the number of bytes actually read,
+ * which may be less than SIZE if end of file is reached.
+ * The file's current position is unaffected. */
+off_t
+file_read_pages (struct file *file, void *const pages[], off_t size, off_t file_ofs) {
+	return inode_read_pages (file->inode, pages, size, file_ofs);
+}
+
 /* Writes SIZE bytes from BUFFER into FILE,
  * starting at the file's current position.
  * Returns the number of bytes actually written,
@@ -6,6 +6,9 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/shrinker.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 #include "include/filesys/fat.h"
 
 /* Identifies an inode. */
@@ -58,17 +61,100 @@ byte_to_sector(const struct inode *inode, off_t pos)
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Recently closed inodes, most recent first.  Reopening one of
+ * them saves reading its sector again.  Removed inodes are never
+ * kept here. */
+#define CLOSED_MAX 32
+static struct list closed_inodes;
+static size_t closed_cnt;
+static struct lock closed_lock;
+
+static size_t inode_shrink(size_t target);
+
+static struct shrinker inode_shrinker = {
+	.name = "closed inodes",
+	.shrink = inode_shrink,
+};
+
 /* Initializes the inode module. */
 void inode_init(void)
 {
 	list_init(&open_inodes);
+	list_init(&closed_inodes);
+	lock_init(&closed_lock);
+	shrinker_register(&inode_shrinker);
 }
 
-cluster_t sector_to_cluster(disk_sector_t sector)
+/* Removes and returns the closed inode for SECTOR, or NULL. */
+static struct inode *
+closed_inode_take(disk_sector_t sector)
 {
-	ASSERT(sector >= fat_fs->data_start);
+	struct list_elem *e;
+	struct inode *inode = NULL;
+
+	lock_acquire(&closed_lock);
+	for (e = list_begin(&closed_inodes); e != list_end(&closed_inodes);
+		 e = list_next(e))
+	{
+		struct inode *i = list_entry(e, struct inode, elem);
+		if (i->sector == sector)
+		{
+			list_remove(e);
+			closed_cnt--;
+			inode = i;
+			break;
+		}
+	}
+	lock_release(&closed_lock);
+	return inode;
+}
+
+/* Keeps INODE, which nobody has open any more, for a later
+ * inode_open(), dropping the oldest closed inode if there are
+ * too many. */
+static void
+closed_inode_put(struct inode *inode)
+{
+	struct inode *victim = NULL;
+
+	lock_acquire(&closed_lock);
+	list_push_front(&closed_inodes, &inode->elem);
+	if (++closed_cnt > CLOSED_MAX)
+	{
+		victim = list_entry(list_pop_back(&closed_inodes), struct inode, elem);
+		closed_cnt--;
+	}
+	lock_release(&closed_lock);
+	free(victim);
+}
+
+/* Shrinker: frees closed inodes, oldest first, until TARGET pages
+ * have gone back to the page allocator or none are left.  A page
+ * goes back only when the last block of its malloc() arena is
+ * freed, so this returns that count, not the inodes freed.  It
+ * stops at the first inode whose arena is busy rather than wait. */
+static size_t
+inode_shrink(size_t target)
+{
+	size_t pages = 0;
+
+	if (!lock_try_acquire(&closed_lock))
+		return 0;
+	while (closed_cnt > 0 && pages < target)
+	{
+		struct inode *inode = list_entry(list_pop_back(&closed_inodes), struct inode, elem);
+		int released = free_nowait(inode);
 
-	return sector - fat_fs->data_start + 1;
+		if (released < 0)
+		{
+			list_push_back(&closed_inodes, &inode->elem);
+			break;
+		}
+		closed_cnt--;
+		pages += released;
+	}
+	lock_release(&closed_lock);
+	return pages;
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -187,6 +273,15 @@ inode_open(disk_sector_t sector)
 		}
 	}
 
+	/* 최근에 닫힌 아이노드라면 디스크를 다시 읽지 않는다. */
+	inode = closed_inode_take(sector);
+	if (inode != NULL)
+	{
+		list_push_front(&open_inodes, &inode->elem);
+		inode->open_cnt = 1;
+		return inode;
+	}
+
 	/* Allocate memory for incore inode */
 	inode = malloc(sizeof *inode);
 	if (inode == NULL)
@@ -240,9 +335,10 @@ void inode_close(struct inode *inode)
 #endif
 			free_map_release(inode->sector, 1);
 			free_map_release(inode->data.start, bytes_to_sectors(inode->data.length));
+			free(inode); // 아이노드 구조체도 메모리에서 반환한다.
 		}
-
-		free(inode); // 아이노드 구조체도 메모리에서 반환한다.
+		else
+			closed_inode_put(inode);
 	}
 }
 
@@ -308,6 +404,48 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
 	return bytes_read;
 }
 
+/* Most sectors inode_read_pages() hands to one disk_readv(). */
+#define READV_SECTORS 32
+
+/* Reads SIZE bytes from INODE, starting at OFFSET, which must be
+ * sector-aligned, into the page-sized buffers PAGES[0], PAGES[1], ...
+ * in turn.  Whole sectors that lie next to each other on disk are
+ * read with a single disk command instead of one each.
+ * Returns the number of bytes actually read, which may be less
+ * than SIZE if end of file is reached. */
+off_t inode_read_pages(struct inode *inode, void *const pages[], off_t size, off_t offset)
+{
+	void *sectors[READV_SECTORS];
+	off_t bytes_read = 0;
+
+	ASSERT(offset % DISK_SECTOR_SIZE == 0);
+	if (offset >= inode_length(inode))
+		return 0;
+	if (size > inode_length(inode) - offset)
+		size = inode_length(inode) - offset;
+
+	while (size - bytes_read >= DISK_SECTOR_SIZE)
+	{
+		disk_sector_t first = byte_to_sector(inode, offset + bytes_read);
+		size_t cnt = 0;
+
+		/* 디스크에서 이어지는 섹터를 한 번에 모아 읽는다. */
+		do
+		{
+			sectors[cnt++] = (uint8_t *)pages[bytes_read / PGSIZE] + bytes_read % PGSIZE;
+			bytes_read += DISK_SECTOR_SIZE;
+		} while (cnt < READV_SECTORS && size - bytes_read >= DISK_SECTOR_SIZE &&
+				 byte_to_sector(inode, offset + bytes_read) == first + cnt);
+		disk_readv(filesys_disk, first, sectors, cnt);
+	}
+
+	/* 마지막 섹터의 일부는 bounce buffer를 거쳐 읽는다. */
+	if (bytes_read < size)
+		bytes_read += inode_read_at(inode, (uint8_t *)pages[bytes_read / PGSIZE] + bytes_read % PGSIZE,
+									size - bytes_read, offset + bytes_read);
+	return bytes_read;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
  * Returns the number of bytes actually written, which may be
  * less than SIZE if end of file is reached or an error occurs.
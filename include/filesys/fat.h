@@ -40,7 +40,6 @@ struct fat_fs
     // struct lock write_lock;
 };
 
-static struct fat_fs *fat_fs;
 struct bitmap *fat_bitmap;
 
 void fat_init(void);
@@ -59,5 +58,7 @@ void fat_remove_chain(
 cluster_t fat_get(cluster_t clst);
 void fat_put(cluster_t clst, cluster_t val);
 disk_sector_t cluster_to_sector(cluster_t clst);
+cluster_t sector_to_cluster(disk_sector_t sector);
+size_t fat_memory_pages(void);
 
 #endif /* filesys/fat.h */
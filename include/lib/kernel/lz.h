@@ -0,0 +1,22 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* LZ77 compression in the format of LZF: fast, with a window of
+   8 kB, which covers a whole page. */
+
+/* Number of bits in the hash of three bytes that finds earlier
+   occurrences of them. */
+#define LZ_HASH_BITS 12
+
+/* Bytes of scratch memory lz_compress() needs.  It is too big to
+   live on a kernel stack, so callers provide it. */
+#define LZ_WORK_SIZE (sizeof (uint16_t) << LZ_HASH_BITS)
+
+size_t lz_compress (const void *in, size_t in_len, void *out, size_t out_len,
+                    void *work);
+size_t lz_decompress (const void *in, size_t in_len, void *out, size_t out_len);
+
+#endif /* lib/kernel/lz.h */
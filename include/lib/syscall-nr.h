@@ -36,6 +36,20 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_MADVISE,                /* Advise how a range of memory will be used. */
 };
 
+/* Flag OR'd into the WRITABLE argument of mmap(): reads the whole
+   mapping in before returning. */
+#define MAP_POPULATE 0x2
+
+/* ADVICE values for madvise(). */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Read one page per fault. */
+#define MADV_SEQUENTIAL 2       /* Read far ahead, evict behind. */
+#define MADV_WILLNEED 3         /* Read the pages in now. */
+#define MADV_DONTNEED 4         /* Discard the pages now. */
+
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,27 @@
+#ifndef THREADS_HEAPPROF_H
+#define THREADS_HEAPPROF_H
+
+/* Kernel heap profiler.
+ *
+ * Built only when HEAPPROF is defined, e.g. by adding -DHEAPPROF to
+ * DEFINES in the project's Make.vars.  Every malloc(), calloc(),
+ * realloc() and palloc_get_multiple() is charged to the address it
+ * was called from, so the dump tells which call site owns the kernel
+ * and user pools.  Feed the printed addresses to `backtrace' to get
+ * function names and line numbers. */
+
+#include <stddef.h>
+
+/* What kind of allocator handed out a block. */
+enum heapprof_kind {
+	HP_MALLOC,                  /* malloc() family, sized in bytes. */
+	HP_PALLOC_KERNEL,           /* Kernel pool, sized in pages. */
+	HP_PALLOC_USER,             /* User pool, sized in pages. */
+};
+
+void heapprof_alloc (void *, size_t, enum heapprof_kind, void *caller);
+void heapprof_free (void *);
+void heapprof_dump (void);
+void heapprof_report_leaks (void);
+
+#endif /* threads/heapprof.h */
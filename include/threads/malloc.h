@@ -9,5 +9,7 @@ void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+int free_nowait (void *);
+void malloc_get_usage (size_t *arena_pages, size_t *big_pages);
 
 #endif /* threads/malloc.h */
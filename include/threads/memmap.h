@@ -0,0 +1,15 @@
+#ifndef THREADS_MEMMAP_H
+#define THREADS_MEMMAP_H
+
+/* Physical memory map.
+ *
+ * Walks both page pools, the VM frame table and every process's
+ * page tables, and prints where the pages went: free run lengths
+ * per pool, pages per kind of owner, and pages per process.
+ * Printed by the "memmap" action, at power-off with -memmap, and
+ * whenever any thread executes "int $0x45". */
+
+void memmap_init (void);
+void memmap_dump (void);
+
+#endif /* threads/memmap.h */
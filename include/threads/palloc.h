@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -17,7 +18,27 @@ extern size_t user_page_limit;
 uint64_t palloc_init (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
+void *palloc_get_aligned (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+size_t palloc_reclaim_wanted (enum palloc_flags);
+size_t palloc_available (enum palloc_flags);
+bool palloc_is_lent (void *);
+void palloc_print_stats (void);
+int palloc_frag_index (enum palloc_flags, size_t page_cnt);
+
+/* Free run lengths are counted in power-of-2 buckets: 1 page,
+   2-3 pages, 4-7 pages, and so on, up to PALLOC_RUN_BUCKETS. */
+#define PALLOC_RUN_BUCKETS 16
+
+/* A snapshot of one pool. */
+struct palloc_usage {
+	size_t total;                     /* Pages in the pool. */
+	size_t used;                      /* Pages allocated. */
+	size_t lent;                      /* Of which lent to the other pool. */
+	size_t runs[PALLOC_RUN_BUCKETS];  /* Free run length histogram. */
+};
+
+void palloc_get_usage (enum palloc_flags, struct palloc_usage *);
 
 #endif /* threads/palloc.h */
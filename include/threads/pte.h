@@ -41,5 +41,12 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=PDE maps a huge page itself. */
+
+/* A page directory entry with PTE_PS set maps a whole 2 MB huge
+   page instead of pointing to a page table.  Its accessed and
+   dirty bits then cover all HPAGE_CNT small pages of it. */
+#define HPAGE_SIZE (1UL << PDXSHIFT)     /* Bytes in a huge page. */
+#define HPAGE_CNT (HPAGE_SIZE / PGSIZE)  /* Small pages in a huge page. */
 
 #endif /* threads/pte.h */
@@ -0,0 +1,32 @@
+#ifndef THREADS_SHRINKER_H
+#define THREADS_SHRINKER_H
+
+/* Shrinkers.
+ *
+ * A subsystem that keeps memory around only to go faster (a cache
+ * of closed inodes, spare malloc arenas, ...) registers a shrinker
+ * so that it can be asked for that memory back.  The page allocator
+ * calls shrink_caches() before it fails a request, and VM eviction
+ * gets there through the page allocator before it picks a victim. */
+
+#include <stddef.h>
+
+struct shrinker {
+	const char *name;           /* Shown in the statistics. */
+
+	/* Releases about TARGET pages worth of cached memory and
+	   returns how many pages it gave back to the page allocator.
+	   Called with arbitrary locks held, so it must not block:
+	   use lock_try_acquire() and skip what is busy. */
+	size_t (*shrink) (size_t target);
+
+	size_t calls;               /* Times asked to shrink. */
+	size_t freed;               /* Pages given back in total. */
+	struct shrinker *next;      /* Next registered shrinker. */
+};
+
+void shrinker_register (struct shrinker *);
+size_t shrink_caches (size_t target);
+void shrinker_print_stats (void);
+
+#endif /* threads/shrinker.h */
@@ -135,8 +135,7 @@ struct thread
 	struct supplemental_page_table spt;
 	// struct hash vm;
 	/* for stack growth */
-	void *user_rsp;
-	void *stack_bottom;
+	void *user_rsp; /* system call에 들어올 때의 유저 rsp */
 	/* for memory mapped files */
 	struct list *mmap_list;
 	// #endif
@@ -169,6 +168,10 @@ const char *thread_name(void);
 void thread_exit(void) NO_RETURN;
 void thread_yield(void);
 
+/* Performs some operation on thread t, given auxiliary data AUX. */
+typedef void thread_action_func(struct thread *t, void *aux);
+void thread_foreach(thread_action_func *, void *);
+
 int thread_get_priority(void);
 void thread_set_priority(int);
 
@@ -9,7 +9,7 @@ struct lock file_lock; /* proventing race condition against  */
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
 
-struct page *check_address(void *addr);
+struct vma *check_address(void *addr);
 void halt(void);
 void exit(int status);
 bool create(const char *file, unsigned initial_size);
@@ -25,9 +25,9 @@ void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close(int fd);
 int add_file_to_fdt(struct file *file);
-void check_valid_buffer(void *buffer, unsigned size, bool is_read);
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap(void *addr);
+int madvise(void *addr, size_t length, int advice);
 /* ---------------------------------------------------------- */
 
 #endif /* userprog/syscall.h */
\ No newline at end of file
@@ -15,7 +15,18 @@ struct anon_page
     int swap_index;
 };
 
+/* 한 번에 묶어 내보낼 수 있는 최대 페이지 수 */
+#define SWAP_CLUSTER_MAX 8
+
+/* swap readahead 창의 최대 크기 (fault난 페이지 제외) */
+#define SWAP_RA_MAX 8
+
 void vm_anon_init(void);
 bool anon_initializer(struct page *page, enum vm_type type, void *kva);
+bool anon_swap_out_cluster(struct page *pages[], size_t cnt);
+void anon_swap_in_cluster(struct page *pages[], size_t cnt);
+void anon_print_stats(void);
+void anon_share_swap_slot(struct page *dst, struct page *src);
+void anon_drop_swap_slot(struct page *page);
 
 #endif
\ No newline at end of file
@@ -17,9 +17,16 @@ struct file_page
 	int swap_index;
 };
 
+/* 파일 fault 하나에 함께 읽을 수 있는 최대 페이지 수 (fault난 페이지 제외) */
+#define FAULT_AROUND_MAX 16
+
+/* -fault-around=PAGES: 위의 상한을 더 낮춘다. 0이면 한 페이지씩 읽는다. */
+extern size_t fault_around_pages;
+
 void vm_file_init(void);
 bool file_backed_initializer(struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
 			  struct file *file, off_t offset);
 void do_munmap(void *va);
+void do_munmap_all(void);
 #endif
\ No newline at end of file
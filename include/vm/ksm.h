@@ -0,0 +1,14 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+#include <stddef.h>
+
+struct frame;
+
+/* -ksm=PAGES: ksmd가 한 번 깨어날 때마다 검사할 프레임 수. 0이면 끈다. */
+extern size_t ksm_scan_pages;
+
+void ksm_init(void);
+void ksm_remove(struct frame *frame);
+void ksm_print_stats(void);
+
+#endif /* VM_KSM_H */
@@ -0,0 +1,13 @@
+#ifndef VM_KSWAPD_H
+#define VM_KSWAPD_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/* -kswapd=PAGES: 사용자 프레임이 이만큼 남으면 kswapd를 깨운다. 0이면 끈다. */
+extern size_t kswapd_low_pages;
+
+void kswapd_init(void);
+bool kswapd_enabled(void);
+void kswapd_check(void);
+
+#endif /* VM_KSWAPD_H */
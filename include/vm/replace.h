@@ -0,0 +1,39 @@
+#ifndef VM_REPLACE_H
+#define VM_REPLACE_H
+#include <stdbool.h>
+
+struct frame;
+
+/* Which policy list a frame is on (struct frame's lru member). */
+enum frame_lru
+{
+	FRAME_UNLISTED, /* 어느 리스트에도 없음 */
+	FRAME_INACTIVE, /* 2q: A1in, 한 번만 참조됨 */
+	FRAME_ACTIVE,	/* 2q: Am, 다시 참조됨 */
+};
+
+/* A page replacement policy, chosen with the -vm-policy kernel
+ * option.  Every hook is called with frame_lock held. */
+struct replace_policy
+{
+	const char *name;
+	void (*init)(void);
+	/* FRAME has just been filled with FRAME->page. */
+	void (*insert)(struct frame *frame);
+	/* FRAME is about to be evicted or freed. */
+	void (*remove)(struct frame *frame);
+	/* FRAME will not be used again soon and should go before others. */
+	void (*deactivate)(struct frame *frame);
+	/* Returns an unpinned frame to evict, or NULL if none. */
+	struct frame *(*victim)(void);
+};
+
+bool replace_select(const char *name);
+const char *replace_name(void);
+void replace_init(void);
+void replace_insert(struct frame *frame);
+void replace_remove(struct frame *frame);
+void replace_deactivate(struct frame *frame);
+struct frame *replace_victim(void);
+
+#endif /* VM_REPLACE_H */
@@ -0,0 +1,19 @@
+#ifndef VM_RSS_H
+#define VM_RSS_H
+#include <stddef.h>
+#include <stdint.h>
+
+struct page;
+
+/* -rss-limit=PAGES: 상주 페이지가 이만큼이면 자기 페이지부터 내보낸다. 0이면 끈다. */
+extern size_t rss_limit_pages;
+
+/* -ws-interval=TICKS: working set 표본을 뜨는 간격. 0이면 끈다. */
+extern int64_t ws_interval;
+
+void rss_init(void);
+void rss_note_access(struct page *page);
+void rss_exit(void);
+void rss_print_stats(void);
+
+#endif /* VM_RSS_H */
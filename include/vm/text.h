@@ -0,0 +1,12 @@
+#ifndef VM_TEXT_H
+#define VM_TEXT_H
+
+struct frame;
+struct aux_for_lazy_load;
+
+void text_init(void);
+struct frame *text_lookup(const struct aux_for_lazy_load *aux);
+void text_insert(struct frame *frame, const struct aux_for_lazy_load *aux);
+void text_remove(struct frame *frame);
+
+#endif /* VM_TEXT_H */
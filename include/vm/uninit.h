@@ -23,4 +23,8 @@ struct uninit_page
 void uninit_new(struct page *page, void *va, vm_initializer *init,
 				enum vm_type type, void *aux,
 				bool (*initializer)(struct page *, enum vm_type, void *kva));
+bool uninit_initialize_loaded(struct page *page, void *kva);
+void uninit_revert(struct page *page, vm_initializer *init,
+				   enum vm_type type, void *aux,
+				   bool (*initializer)(struct page *, enum vm_type, void *kva));
 #endif
\ No newline at end of file
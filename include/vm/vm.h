@@ -36,6 +36,7 @@ enum vm_type
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/vma.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -56,13 +57,20 @@ struct page
 
 	/* --- PROJECT 3 : VM ------------------------------------ */
 	uint8_t type;  /* VM_UNINIT, VM_FILE, VM_ANON의 타입 */
+	struct thread *owner; /* 이 페이지를 매핑한 프로세스 (reverse map) */
+	size_t evict_seq;	  /* 마지막으로 쫓겨날 때의 eviction 번호, 0이면 없음 */
+	struct readahead *readahead; /* 이 페이지를 미리 읽은 창, 아직 쓰였는지 모르면 */
+	struct page *share_next; /* 같은 프레임을 공유하는 다음 페이지 (copy-on-write) */
+	bool zero_mapped;		 /* 아직 uninit이고, 공유 zero 페이지를 읽기 전용으로 매핑 중 */
+	bool young;				 /* working set 표본을 뜨며 지운 accessed 비트 대신 남긴 표시 (vm/rss.c) */
+	size_t ws_epoch;		 /* working set에 마지막으로 센 표본 구간 */
+	struct aux_for_lazy_load *text; /* 실행 파일의 읽기 전용 세그먼트 페이지면 그 위치 */
 	void *va;	   /* page가 관리하는 가상페이지 번호 */
 	bool writable; /* True일 경우 해당 주소에 write 가능
 					   False일 경우 해당 주소에 write 불가능 */
 	// bool is_loaded; 	/* 물리메모리의 탑재 여부를 알려주는 플래그 */
 
 	size_t swap_slot;			/* 스왑 슬롯 */
-	struct hash_elem hash_elem; /* 해시 테이블 Element */
 
 	struct file *load_file; /* 가상주소와 맵핑된 파일 */
 	off_t offset;			/* 읽어야 할 파일 오프셋 */
@@ -96,10 +104,64 @@ struct aux_for_lazy_load
 struct frame
 {
 	void *kva; /* kernel virtual addr */
-	struct page *page;
+	struct page *page; /* 이 프레임을 매핑한 페이지들 중 첫 번째 (share_next로 이어짐) */
+	size_t ref_cnt;	   /* 이 프레임을 매핑한 페이지 수 */
+	bool pinned; /* I/O 중이라 내보내거나 옮기면 안 되는 프레임 */
+	bool evicting; /* 내보내는 중. frame_lock 없이 디스크에 쓰고 있을 수 있다 */
+	bool huge;	 /* 2MB 큰 페이지로 받은 프레임 (compaction으로 옮기지 않는다) */
 	struct list_elem frame_elem;
+	struct list_elem lru_elem; /* 교체 정책의 리스트 (vm/replace.c) */
+	uint8_t lru;			   /* enum frame_lru */
+	uint64_t ksm_sum;		   /* 지난번 ksmd가 검사했을 때의 내용 해시 */
+	bool ksm_hashed;		   /* ksm_sum이 유효함 */
+	bool ksm_listed;		   /* ksm_elem이 ksm의 해시 테이블에 있음 */
+	struct hash_elem ksm_elem; /* vm/ksm.c */
+	struct inode *text_inode;	/* 실행 파일의 읽기 전용 페이지를 담았으면 그 inode */
+	off_t text_ofs;				/* 그 페이지의 파일 오프셋 */
+	size_t text_bytes;			/* 그 페이지에서 파일로부터 읽은 바이트 수 */
+	struct hash_elem text_elem; /* vm/text.c */
 };
 
+/* Totals for one kind of readahead. */
+struct readahead_stats
+{
+	size_t pages;  /* 미리 읽은 페이지 수 */
+	size_t hits;   /* 그중 실제로 쓰인 페이지 수 */
+	size_t misses; /* 쓰이지 않고 버려진 페이지 수 */
+};
+
+/* Fault and eviction counters, for vm_print_stats(). */
+struct vm_stats
+{
+	size_t major_faults; /* 디스크(스왑, 파일)에서 읽어 온 fault */
+	size_t minor_faults; /* 0으로 채우기만 한 fault */
+	size_t zero_maps;	 /* 그중 프레임 없이 zero 페이지를 매핑한 fault */
+	size_t evictions;	 /* 내보낸 프레임 수 */
+	struct readahead_stats swap_ra;		 /* swap readahead */
+	struct readahead_stats fault_around; /* 파일 fault-around */
+	size_t forks;		 /* supplemental_page_table_copy() 호출 수 */
+	int64_t fork_ticks;	 /* 그 안에서 보낸 timer tick 수 */
+	size_t cow_shared;	 /* fork 때 복사하지 않고 공유한 프레임 수 */
+	size_t cow_copies;	 /* 공유 중에 쓰여서 복사한 프레임 수 */
+	size_t cow_reuses;	 /* 혼자 남아 복사 없이 다시 쓰기 가능해진 프레임 수 */
+	size_t text_shared;	 /* 다른 프로세스가 읽어 둔 실행 파일 페이지를 매핑한 fault 수 */
+	size_t text_dropped; /* 쓰지 않고 버린 실행 파일 프레임 수 */
+	size_t execs;		 /* 첫 system call까지 간 exec 수 */
+	int64_t exec_ticks;	 /* 그동안 걸린 timer tick 수 */
+	size_t exec_faults;	 /* 그동안 처리한 page fault 수 */
+	size_t prefetched;	 /* MADV_WILLNEED, MAP_POPULATE로 미리 읽은 페이지 수 */
+	size_t dropped;		 /* MADV_DONTNEED로 버린 페이지 수 */
+	size_t deactivated;	 /* MADV_SEQUENTIAL 범위에서 지나간 뒤 먼저 내보내게 한 페이지 수 */
+	size_t direct_reclaims; /* 빈 프레임이 없어 fault난 프로세스가 직접 내보낸 횟수 */
+	size_t direct_pages;	/* 그때 내보낸 프레임 수 */
+	size_t kswapd_wakeups;	/* kswapd가 깨어난 횟수 */
+	size_t kswapd_pages;	/* kswapd가 돌려준 프레임 수 */
+	size_t huge_faults;		/* 2MB 큰 페이지 하나로 매핑한 fault 수 */
+	size_t huge_fallbacks;	/* 큰 페이지로 매핑할 수 있었지만 정렬된 2MB가 없어 4KB로 물러선 fault 수 */
+};
+extern struct vm_stats vm_stats;
+extern bool thp_enabled;
+
 /* The function table for page operations.
  * This is one way of implementing "interface" in C.
  * Put the table of "method" into the struct's member, and
@@ -118,14 +180,49 @@ struct page_operations
 	if ((page)->operations->destroy) \
 	(page)->operations->destroy(page)
 
+/* A window of pages read in along with the one that faulted, sized
+ * by how many pages of the previous windows were actually used.
+ * Swap readahead and file fault-around each keep one per process. */
+struct readahead
+{
+	size_t window; /* fault 하나에 더 읽을 페이지 수 */
+	size_t max;	   /* window의 상한, 0이면 더 읽지 않는다 */
+	size_t hits;   /* 마지막으로 창을 조정한 뒤의 hit 수 */
+	size_t misses; /* 마지막으로 창을 조정한 뒤의 miss 수 */
+	void *start;   /* 마지막 창의 첫 주소 */
+	size_t cnt;	   /* 마지막 창의 페이지 수 */
+	struct readahead_stats *stats; /* 전체 통계 */
+};
+
 /* Representation of current process's memory space.
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table
 {
 	/* --- PROJECT 3 : VM ------------------------------------ */
-	struct hash vm;
+	void *pages; /* 가상 페이지 번호로 찾는 4단계 radix tree의 최상위 표 (vm/spt.c) */
 	/* ------------------------------------------------------- */
+
+	struct rb_tree vmas;		   /* 주소 공간의 영역들 (vm/vma.c), 페이지는 처음 쓸 때 만든다 */
+
+	struct readahead swap_ra;	   /* swap slot이 이어지는 anonymous 페이지 */
+	struct readahead fault_around; /* 파일에서 이어지는 페이지 */
+
+	/* exec부터 새 프로그램의 첫 system call까지 */
+	int64_t exec_start; /* exec을 시작한 tick, 이미 지났으면 -1 */
+	size_t exec_faults; /* 그동안 처리한 page fault 수 */
+
+	/* 상주 집합과 working set (vm/rss.c) */
+	size_t rss;			  /* 프레임이 있는 페이지 수 */
+	size_t rss_peak;	  /* rss의 최댓값 */
+	size_t rss_reclaims;  /* -rss-limit에 닿아 스스로 내보낸 페이지 수 */
+	void *reclaim_cursor; /* 스스로 내보낼 페이지를 다음에 찾기 시작할 주소 */
+	size_t ws_tally;	  /* 이번 표본 구간에 쓰인 페이지 수 */
+	size_t ws_pages;	  /* 마지막으로 끝난 구간의 working set 추정치 */
+	size_t ws_peak;		  /* ws_pages의 최댓값 */
+	size_t ws_samples;	  /* 끝난 표본 구간 수 */
+	size_t major_faults;  /* 이 프로세스의 major fault 수 */
+	size_t minor_faults;  /* 이 프로세스의 minor fault 수 */
 };
 
 #include "threads/thread.h"
@@ -135,8 +232,11 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst,
 void supplemental_page_table_kill(struct supplemental_page_table *spt);
 struct page *spt_find_page(struct supplemental_page_table *spt,
 						   void *va);
+struct page *spt_get_page(struct supplemental_page_table *spt, void *va);
 bool spt_insert_page(struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page);
+struct page *spt_next_page(struct supplemental_page_table *spt, void *va, void *end);
+void spt_destroy_pages(struct supplemental_page_table *spt);
 
 void vm_init(void);
 bool vm_try_handle_fault(struct intr_frame *f, void *addr, bool user,
@@ -148,6 +248,23 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage,
 									bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page(struct page *page);
 bool vm_claim_page(void *va);
+struct vma *vm_find_area(void *addr, uintptr_t rsp);
+void vm_free_frame(struct frame *frame);
+void vm_lock_frames(void);
+void vm_unlock_frames(void);
+bool vm_unlock_frames_for_io(struct page *pages[], size_t cnt);
+void vm_wait_evicted(struct page *page);
+void vm_page_release_frame(struct page *page);
+size_t vm_reclaim(void);
+void vm_for_each_movable_frame(void (*func)(void *kva, void *aux), void *aux);
+void vm_migrate_frame(void *from, void *to);
+struct frame *vm_test_frame(struct page *page, void *kva);
+void vm_print_stats(void);
+void vm_readahead_settle(struct page *page, bool used);
+void vm_exec_begin(void);
+void vm_exec_end(void);
+bool vm_madvise(void *addr, size_t length, int advice);
+void vm_prefetch(void *addr, size_t length);
 enum vm_type page_get_type(struct page *page);
 static bool vm_do_claim_page(struct page *page);
 
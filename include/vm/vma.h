@@ -0,0 +1,44 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lib/kernel/rbtree.h"
+#include "filesys/off_t.h"
+#include "vm/vm.h"
+
+struct file;
+struct supplemental_page_table;
+enum vm_type;
+
+/* A range of a process's virtual memory whose pages are all of one
+ * kind: an ELF segment, a file mapping or the stack.  The struct page
+ * for each of its pages is only made when the page is first touched
+ * (see spt_get_page()), from what the range records here. */
+struct vma
+{
+	void *start;		/* 첫 페이지의 주소 */
+	void *end;			/* 마지막 페이지 바로 다음 주소 */
+	enum vm_type type;	/* 페이지를 만들 때 쓸 타입 (VM_ANON, VM_FILE, 스택은 VM_MARKER_0도) */
+	bool writable;		/* 쓰기 가능한 범위인지 */
+	struct file *file;	/* 내용을 읽어 올 파일, 0으로 채우는 범위면 NULL */
+	off_t offset;		/* start에 해당하는 파일 오프셋 */
+	size_t read_bytes;	/* start부터 파일에서 읽을 바이트 수, 나머지는 0 */
+	uint8_t advice;		/* madvise()로 받은 MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL */
+	struct rb_elem elem; /* supplemental_page_table의 vmas, start 순 */
+};
+
+void vma_init(struct supplemental_page_table *spt);
+struct vma *vma_add(struct supplemental_page_table *spt, void *start, void *end,
+					enum vm_type type, bool writable, struct file *file, off_t offset,
+					size_t read_bytes);
+void vma_remove(struct supplemental_page_table *spt, struct vma *vma);
+struct vma *vma_find(struct supplemental_page_table *spt, const void *va);
+struct vma *vma_lookup(struct supplemental_page_table *spt, const void *va);
+struct vma *vma_split(struct supplemental_page_table *spt, struct vma *vma, void *va);
+struct vma *vma_first(struct supplemental_page_table *spt);
+struct vma *vma_next(struct vma *vma);
+bool vma_copy(struct supplemental_page_table *dst, struct supplemental_page_table *src);
+void vma_destroy(struct supplemental_page_table *spt);
+
+#endif /* VM_VMA_H */
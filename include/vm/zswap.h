@@ -0,0 +1,17 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct disk;
+
+/* -zswap=PAGES: 압축한 페이지를 담을 풀의 최대 크기. 0이면 끈다. */
+extern size_t zswap_pool_pages;
+
+void zswap_init(struct disk *disk, size_t slot_cnt);
+bool zswap_store(size_t slot, const void *kva);
+bool zswap_load(size_t slot, void *kva);
+void zswap_invalidate(size_t slot);
+void zswap_print_stats(void);
+
+#endif /* VM_ZSWAP_H */
@@ -3,6 +3,7 @@
 #include <limits.h>
 #include <round.h>
 #include <stdio.h>
+#include <string.h>
 #include "threads/malloc.h"
 #ifdef FILESYS
 #include "filesys/file.h"
@@ -21,12 +22,26 @@ typedef unsigned long elem_type;
 /* Number of bits in an element. */
 #define ELEM_BITS (sizeof (elem_type) * CHAR_BIT)
 
+/* Bitmaps with at least this many elements also keep a summary
+   index, see below. */
+#define SUMMARY_MIN ELEM_BITS
+
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   Large bitmaps keep a second level on top of that: bit I of
+   FULL is set when element I has every bit set, and bit I of
+   EMPTY is set when element I has none set.  A scan can then skip
+   ELEM_BITS elements, i.e. ELEM_BITS * ELEM_BITS bits, with a
+   single load, so finding a free bit in a nearly full pool costs
+   O(elements / ELEM_BITS) instead of O(bits).  Small bitmaps do
+   without and have null FULL and EMPTY. */
 struct bitmap {
 	size_t bit_cnt;     /* Number of bits. */
 	elem_type *bits;    /* Elements that represent bits. */
+	elem_type *full;    /* Elements that are all ones, or null. */
+	elem_type *empty;   /* Elements that are all zeros, or null. */
 };
 
 /* Returns the index of the element that contains the bit
@@ -62,6 +77,107 @@ last_mask (const struct bitmap *b) {
 	int last_bits = b->bit_cnt % ELEM_BITS;
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns a bit mask of the bits actually used in element IDX of
+   B's bits. */
+static inline elem_type
+elem_mask (const struct bitmap *b, size_t idx) {
+	return idx == elem_cnt (b->bit_cnt) - 1 ? last_mask (b) : (elem_type) -1;
+}
+
+/* Returns the bits of element IDX that represent bits START
+   through END, exclusive. */
+static inline elem_type
+range_mask (size_t idx, size_t start, size_t end) {
+	size_t lo = idx * ELEM_BITS;
+	elem_type mask = (elem_type) -1;
+
+	if (start > lo)
+		mask &= (elem_type) -1 << (start - lo);
+	if (end < lo + ELEM_BITS)
+		mask &= ((elem_type) 1 << (end - lo)) - 1;
+	return mask;
+}
+
+/* Returns the number of set bits in X. */
+static inline size_t
+popcount (elem_type x) {
+	x = x - ((x >> 1) & 0x5555555555555555UL);
+	x = (x & 0x3333333333333333UL) + ((x >> 2) & 0x3333333333333333UL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (x * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns the index of the lowest set bit in X, which must not
+   be zero. */
+static inline size_t
+lowest_bit (elem_type x) {
+	return __builtin_ctzl (x);
+}
+
+/* Returns the number of elements in each summary of a bitmap
+   with BIT_CNT bits, or 0 if it is too small to need one. */
+static inline size_t
+summary_cnt (size_t bit_cnt) {
+	size_t cnt = elem_cnt (bit_cnt);
+	return cnt >= SUMMARY_MIN ? elem_cnt (cnt) : 0;
+}
+
+/* Returns the number of bytes required for BIT_CNT bits plus
+   their summary, if any. */
+static inline size_t
+storage_cnt (size_t bit_cnt) {
+	return byte_cnt (bit_cnt) + 2 * sizeof (elem_type) * summary_cnt (bit_cnt);
+}
+
+/* Brings the summary bits for element IDX of B up to date. */
+static inline void
+summary_update (struct bitmap *b, size_t idx) {
+	if (b->full != NULL) {
+		elem_type mask = elem_mask (b, idx);
+		elem_type bits = b->bits[idx] & mask;
+		elem_type bit = bit_mask (idx);
+
+		if (bits == mask)
+			b->full[elem_idx (idx)] |= bit;
+		else
+			b->full[elem_idx (idx)] &= ~bit;
+		if (bits == 0)
+			b->empty[elem_idx (idx)] |= bit;
+		else
+			b->empty[elem_idx (idx)] &= ~bit;
+	}
+}
+
+/* Points B's summary at the storage following its bits and
+   rebuilds it, if B is large enough to have one. */
+static void
+summary_init (struct bitmap *b) {
+	size_t cnt = summary_cnt (b->bit_cnt);
+	size_t i;
+
+	if (cnt == 0) {
+		b->full = b->empty = NULL;
+		return;
+	}
+	b->full = b->bits + elem_cnt (b->bit_cnt);
+	b->empty = b->full + cnt;
+	memset (b->full, 0, 2 * cnt * sizeof (elem_type));
+	for (i = 0; i < elem_cnt (b->bit_cnt); i++)
+		summary_update (b, i);
+}
+
+/* Sets the bits of element IDX in B that are set in MASK to
+   VALUE, atomically. */
+static inline void
+elem_set (struct bitmap *b, size_t idx, elem_type mask, bool value) {
+	/* See bitmap_mark() and bitmap_reset(). */
+	if (value)
+		asm ("lock orq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	else
+		asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+	summary_update (b, idx);
+}
 
 /* Creation and destruction. */
 
@@ -74,8 +190,9 @@ bitmap_create (size_t bit_cnt) {
 	struct bitmap *b = malloc (sizeof *b);
 	if (b != NULL) {
 		b->bit_cnt = bit_cnt;
-		b->bits = malloc (byte_cnt (bit_cnt));
+		b->bits = malloc (storage_cnt (bit_cnt));
 		if (b->bits != NULL || bit_cnt == 0) {
+			summary_init (b);
 			bitmap_set_all (b, false);
 			return b;
 		}
@@ -95,6 +212,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED) {
 
 	b->bit_cnt = bit_cnt;
 	b->bits = (elem_type *) (b + 1);
+	summary_init (b);
 	bitmap_set_all (b, false);
 	return b;
 }
@@ -103,7 +221,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED) {
    with BIT_CNT bits (for use with bitmap_create_in_buf()). */
 size_t
 bitmap_buf_size (size_t bit_cnt) {
-	return sizeof (struct bitmap) + byte_cnt (bit_cnt);
+	return sizeof (struct bitmap) + storage_cnt (bit_cnt);
 }
 
 /* Destroys bitmap B, freeing its storage.
@@ -148,6 +266,7 @@ bitmap_mark (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the OR instruction in [IA32-v2b]. */
 	asm ("lock orq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	summary_update (b, idx);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -160,6 +279,7 @@ bitmap_reset (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the AND instruction in [IA32-v2a]. */
 	asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+	summary_update (b, idx);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -174,6 +294,7 @@ bitmap_flip (struct bitmap *b, size_t bit_idx) {
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the XOR instruction in [IA32-v2b]. */
 	asm ("lock xorq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	summary_update (b, idx);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -194,48 +315,59 @@ bitmap_set_all (struct bitmap *b, bool value) {
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, but the range as a whole
+   is not. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
+	size_t end = start + cnt;
 	size_t i;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	if (cnt == 0)
+		return;
+	for (i = elem_idx (start); i <= elem_idx (end - 1); i++)
+		elem_set (b, i, range_mask (i, start, end), value);
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i, value_cnt;
+	size_t end = start + cnt;
+	size_t i, set_cnt;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
-	return value_cnt;
+	if (cnt == 0)
+		return 0;
+	set_cnt = 0;
+	for (i = elem_idx (start); i <= elem_idx (end - 1); i++)
+		set_cnt += popcount (b->bits[i] & range_mask (i, start, end));
+	return value ? set_cnt : cnt - set_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
+	elem_type flip = value ? 0 : (elem_type) -1;
+	size_t end = start + cnt;
 	size_t i;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
+	if (cnt == 0)
+		return false;
+	for (i = elem_idx (start); i <= elem_idx (end - 1); i++)
+		if ((b->bits[i] ^ flip) & range_mask (i, start, end))
 			return true;
 	return false;
 }
@@ -263,6 +395,53 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 
 /* Finding set or unset bits. */
 
+/* Returns the index of the first element of B at or after IDX
+   that has at least one bit set to VALUE, going by B's summary.
+   Returns the number of elements if there is none. */
+static size_t
+next_elem (const struct bitmap *b, size_t idx, bool value) {
+	const elem_type *summary = value ? b->empty : b->full;
+	size_t cnt = elem_cnt (b->bit_cnt);
+	size_t s_idx = elem_idx (idx);
+	elem_type s;
+
+	if (idx >= cnt)
+		return cnt;
+	s = ~summary[s_idx] & ((elem_type) -1 << (idx % ELEM_BITS));
+	while (s == 0) {
+		if (++s_idx >= summary_cnt (b->bit_cnt))
+			return cnt;
+		s = ~summary[s_idx];
+	}
+	idx = s_idx * ELEM_BITS + lowest_bit (s);
+	return idx < cnt ? idx : cnt;
+}
+
+/* Returns the index of the first bit in B at or after START that
+   is set to VALUE, or the size of B if there is none. */
+static size_t
+next_bit (const struct bitmap *b, size_t start, bool value) {
+	elem_type flip = value ? 0 : (elem_type) -1;
+	size_t cnt = elem_cnt (b->bit_cnt);
+	size_t idx, bit;
+	elem_type e;
+
+	if (start >= b->bit_cnt)
+		return b->bit_cnt;
+
+	idx = elem_idx (start);
+	e = (b->bits[idx] ^ flip) & ((elem_type) -1 << (start % ELEM_BITS));
+	while (e == 0) {
+		idx = b->full != NULL ? next_elem (b, idx + 1, value) : idx + 1;
+		if (idx >= cnt)
+			return b->bit_cnt;
+		e = b->bits[idx] ^ flip;
+	}
+
+	bit = idx * ELEM_BITS + lowest_bit (e);
+	return bit < b->bit_cnt ? bit : b->bit_cnt;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
@@ -272,12 +451,27 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
+	if (cnt == 0)
+		return start;
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
-				return i;
+		size_t i = start;
+
+		/* Jump from one run of VALUE bits to the next, and take
+		   the first run that is long enough. */
+		while (i <= last) {
+			size_t run_start = next_bit (b, i, value);
+			size_t run_end;
+
+			if (run_start > last)
+				break;
+			if (cnt == 1)
+				return run_start;
+			run_end = next_bit (b, run_start, !value);
+			if (run_end - run_start >= cnt)
+				return run_start;
+			i = run_end;
+		}
 	}
 	return BITMAP_ERROR;
 }
@@ -315,6 +509,7 @@ bitmap_read (struct bitmap *b, struct file *file) {
 		off_t size = byte_cnt (b->bit_cnt);
 		success = file_read_at (file, b->bits, size, 0) == size;
 		b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+		summary_init (b);
 	}
 	return success;
 }
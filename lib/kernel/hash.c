@@ -9,14 +9,6 @@
 #include "../debug.h"
 #include "threads/malloc.h"
 
-/* --- PROJECT 3 : VM ------------------------------------ */
-#include "vm/vm.h"
-/* 나중에 아래 헤더도 되는지 돌려보기
-	#ifndef VM_VM_H
-	#define VM_VM_H */
-
-/* ------------------------------------------------------- */
-
 #define list_elem_to_hash_elem(LIST_ELEM) \
 	list_entry(LIST_ELEM, struct hash_elem, list_elem)
 
@@ -428,35 +420,3 @@ remove_elem(struct hash *h, struct hash_elem *e)
 	h->elem_cnt--;
 	list_remove(&e->list_elem);
 }
-
-/* --- PROJECT 3 : VM ------------------------------------ */
-/* helper functions for hash table */
-unsigned
-page_hash(const struct hash_elem *p_, void *aux)
-{
-	const struct page *page = hash_entry(p_, struct page, hash_elem);
-	return hash_bytes(&page->va, sizeof page->va);
-}
-
-/* hash_less func - compare va */
-bool page_less(const struct hash_elem *a, const struct hash_elem *b, void *aux)
-{
-	const struct page *page_a = hash_entry(a, struct page, hash_elem);
-	const struct page *page_b = hash_entry(b, struct page, hash_elem);
-
-	return page_a->va < page_b->va;
-}
-
-/* get page with va */
-struct page *page_lookup(const void *va)
-{
-	struct page page;
-	struct hash_elem *hash_elem;
-
-	page.va = pg_round_down(va);
-	hash_elem = hash_find(&thread_current()->spt.vm, &page.hash_elem);
-
-	return hash_elem != NULL ? hash_entry(hash_elem, struct page, hash_elem) : NULL;
-}
-
-/* ------------------------------------------------------- */
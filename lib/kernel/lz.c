@@ -0,0 +1,153 @@
+#include "lz.h"
+#include <debug.h>
+#include <string.h>
+
+/* Compressed data is a sequence of runs, each starting with a
+   control byte C:
+
+   - C < 32: the next C + 1 bytes are copied as is.
+
+   - Otherwise, bytes are copied from earlier in the output.  The
+     top three bits of C give the length minus 2; if they are all
+     set, the next byte is added to it.  The low five bits of C
+     and the byte after that give the distance back minus 1. */
+
+#define MAX_LIT 32                      /* Longest literal run. */
+#define MAX_OFF (1 << 13)               /* Farthest reference. */
+#define MAX_REF (7 + 255 + 2)           /* Longest reference. */
+
+/* Hashes the three bytes at P. */
+static inline unsigned
+hash3 (const uint8_t *p)
+{
+  unsigned v = ((unsigned) p[0] << 16) | (p[1] << 8) | p[2];
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Compresses the IN_LEN bytes at IN into the OUT_LEN bytes at OUT,
+   using the LZ_WORK_SIZE bytes at WORK as scratch space.  Returns
+   the compressed size, or 0 if it would not fit in OUT_LEN. */
+size_t
+lz_compress (const void *in_, size_t in_len, void *out_, size_t out_len,
+             void *work)
+{
+  const uint8_t *in = in_;
+  uint8_t *out = out_;
+  uint16_t *table = work;       /* Last position + 1 of each hash. */
+  size_t ip = 0, op = 0;
+  size_t lit = 0;               /* Length of the current literal run. */
+
+  ASSERT (in_len < UINT16_MAX);
+  memset (table, 0, LZ_WORK_SIZE);
+
+  /* OUT[op - lit - 1] is kept for the control byte of the current
+     literal run.  It is dropped again if the run stays empty. */
+  op++;
+  while (ip < in_len)
+    {
+      if (ip + 2 < in_len)
+        {
+          unsigned h = hash3 (in + ip);
+          size_t ref = table[h];
+
+          table[h] = ip + 1;
+          if (ref-- != 0 && ip - ref <= MAX_OFF
+              && memcmp (in + ref, in + ip, 3) == 0)
+            {
+              size_t off = ip - ref - 1;
+              size_t max = in_len - ip < MAX_REF ? in_len - ip : MAX_REF;
+              size_t len = 3;
+
+              while (len < max && in[ref + len] == in[ip + len])
+                len++;
+
+              if (lit > 0)
+                out[op - lit - 1] = lit - 1;
+              else
+                op--;
+              if (op + 3 > out_len)
+                return 0;
+
+              ip += len;
+              len -= 2;
+              if (len < 7)
+                out[op++] = (off >> 8) + (len << 5);
+              else
+                {
+                  out[op++] = (off >> 8) + (7 << 5);
+                  out[op++] = len - 7;
+                }
+              out[op++] = off & 0xff;
+              lit = 0;
+              op++;
+              continue;
+            }
+        }
+
+      if (op >= out_len)
+        return 0;
+      out[op++] = in[ip++];
+      if (++lit == MAX_LIT)
+        {
+          out[op - lit - 1] = lit - 1;
+          lit = 0;
+          op++;
+        }
+    }
+
+  if (lit > 0)
+    out[op - lit - 1] = lit - 1;
+  else
+    op--;
+  return op;
+}
+
+/* Decompresses the IN_LEN bytes at IN, produced by lz_compress(),
+   into the OUT_LEN bytes at OUT.  Returns the number of bytes
+   produced, or 0 if IN is corrupt or does not fit in OUT. */
+size_t
+lz_decompress (const void *in_, size_t in_len, void *out_, size_t out_len)
+{
+  const uint8_t *in = in_;
+  uint8_t *out = out_;
+  size_t ip = 0, op = 0;
+
+  while (ip < in_len)
+    {
+      unsigned ctrl = in[ip++];
+
+      if (ctrl < MAX_LIT)
+        {
+          size_t len = ctrl + 1;
+
+          if (ip + len > in_len || op + len > out_len)
+            return 0;
+          memcpy (out + op, in + ip, len);
+          ip += len;
+          op += len;
+        }
+      else
+        {
+          size_t len = ctrl >> 5;
+          size_t off;
+
+          if (len == 7)
+            {
+              if (ip >= in_len)
+                return 0;
+              len += in[ip++];
+            }
+          if (ip >= in_len)
+            return 0;
+          off = ((ctrl & 0x1f) << 8) + in[ip++] + 1;
+          len += 2;
+          if (off > op || op + len > out_len)
+            return 0;
+
+          /* The source may overlap what is being written. */
+          for (; len > 0; len--, op++)
+            out[op] = out[op - off];
+        }
+    }
+  return op;
+}
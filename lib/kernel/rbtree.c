@@ -0,0 +1,387 @@
+#include "rbtree.h"
+
+/* Red-black tree, after Cormen et al., "Introduction to
+   Algorithms", chapter 13.  Leaves are null pointers, which count
+   as black. */
+
+static bool is_red (const struct rb_elem *);
+static void set_child (struct rb_tree *, struct rb_elem *parent,
+                       struct rb_elem *old, struct rb_elem *new);
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+                          struct rb_elem *parent);
+
+/* Initializes tree T to compare elements using LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rb_tree *t, rb_less_func *less, void *aux)
+{
+  t->root = NULL;
+  t->elem_cnt = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/* Inserts NEW into tree T and returns a null pointer, if no
+   element equal to it is already in the tree.  If one is, returns
+   it without inserting NEW. */
+struct rb_elem *
+rb_insert (struct rb_tree *t, struct rb_elem *new)
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &t->root;
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (t->less (new, parent, t->aux))
+        link = &parent->left;
+      else if (t->less (parent, new, t->aux))
+        link = &parent->right;
+      else
+        return parent;
+    }
+
+  new->parent = parent;
+  new->left = new->right = NULL;
+  new->red = true;
+  *link = new;
+  t->elem_cnt++;
+  insert_fixup (t, new);
+  return NULL;
+}
+
+/* Removes E, which must be in tree T. */
+void
+rb_remove (struct rb_tree *t, struct rb_elem *e)
+{
+  struct rb_elem *x, *parent;
+  bool removed_red;
+
+  if (e->left == NULL || e->right == NULL)
+    {
+      /* E has at most one child, which takes its place. */
+      x = e->left != NULL ? e->left : e->right;
+      parent = e->parent;
+      removed_red = e->red;
+      if (x != NULL)
+        x->parent = parent;
+      set_child (t, e->parent, e, x);
+    }
+  else
+    {
+      /* E's successor Y, which has no left child, takes its
+         place, and Y's right child takes Y's. */
+      struct rb_elem *y = e->right;
+
+      while (y->left != NULL)
+        y = y->left;
+      removed_red = y->red;
+      x = y->right;
+      if (y->parent == e)
+        parent = y;
+      else
+        {
+          parent = y->parent;
+          if (x != NULL)
+            x->parent = parent;
+          parent->left = x;
+          y->right = e->right;
+          y->right->parent = y;
+        }
+      y->left = e->left;
+      y->left->parent = y;
+      y->parent = e->parent;
+      set_child (t, e->parent, e, y);
+      y->red = e->red;
+    }
+
+  t->elem_cnt--;
+  if (!removed_red)
+    remove_fixup (t, x, parent);
+}
+
+/* Returns the element of tree T equal to KEY, or a null pointer
+   if there is none. */
+struct rb_elem *
+rb_find (struct rb_tree *t, const struct rb_elem *key)
+{
+  struct rb_elem *e = t->root;
+
+  while (e != NULL)
+    {
+      if (t->less (key, e, t->aux))
+        e = e->left;
+      else if (t->less (e, key, t->aux))
+        e = e->right;
+      else
+        return e;
+    }
+  return NULL;
+}
+
+/* Returns the greatest element of tree T that is not greater
+   than KEY, or a null pointer if all of them are. */
+struct rb_elem *
+rb_floor (struct rb_tree *t, const struct rb_elem *key)
+{
+  struct rb_elem *e = t->root;
+  struct rb_elem *floor = NULL;
+
+  while (e != NULL)
+    {
+      if (t->less (key, e, t->aux))
+        e = e->left;
+      else
+        {
+          floor = e;
+          e = e->right;
+        }
+    }
+  return floor;
+}
+
+/* Returns the least element of tree T, or a null pointer if T
+   is empty. */
+struct rb_elem *
+rb_first (struct rb_tree *t)
+{
+  struct rb_elem *e = t->root;
+
+  if (e != NULL)
+    while (e->left != NULL)
+      e = e->left;
+  return e;
+}
+
+/* Returns the element after E in its tree, or a null pointer if E
+   is the last one. */
+struct rb_elem *
+rb_next (struct rb_elem *e)
+{
+  if (e->right != NULL)
+    {
+      e = e->right;
+      while (e->left != NULL)
+        e = e->left;
+      return e;
+    }
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the element before E in its tree, or a null pointer if
+   E is the first one. */
+struct rb_elem *
+rb_prev (struct rb_elem *e)
+{
+  if (e->left != NULL)
+    {
+      e = e->left;
+      while (e->right != NULL)
+        e = e->right;
+      return e;
+    }
+  while (e->parent != NULL && e == e->parent->left)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (struct rb_tree *t)
+{
+  return t->elem_cnt;
+}
+
+/* Returns true if T contains no elements, false otherwise. */
+bool
+rb_empty (struct rb_tree *t)
+{
+  return t->elem_cnt == 0;
+}
+
+/* Returns true if E is a red node, false if it is black or a
+   leaf. */
+static bool
+is_red (const struct rb_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Makes NEW the child of PARENT that OLD was, or the root of T if
+   PARENT is null. */
+static void
+set_child (struct rb_tree *t, struct rb_elem *parent,
+           struct rb_elem *old, struct rb_elem *new)
+{
+  if (parent == NULL)
+    t->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+}
+
+/* Makes X's right child its parent. */
+static void
+rotate_left (struct rb_tree *t, struct rb_elem *x)
+{
+  struct rb_elem *y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  y->parent = x->parent;
+  set_child (t, x->parent, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/* Makes X's left child its parent. */
+static void
+rotate_right (struct rb_tree *t, struct rb_elem *x)
+{
+  struct rb_elem *y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  y->parent = x->parent;
+  set_child (t, x->parent, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/* Restores the red-black properties after red node E was
+   inserted. */
+static void
+insert_fixup (struct rb_tree *t, struct rb_elem *e)
+{
+  while (is_red (e->parent))
+    {
+      struct rb_elem *parent = e->parent;
+      struct rb_elem *grandparent = parent->parent;
+
+      if (parent == grandparent->left)
+        {
+          struct rb_elem *uncle = grandparent->right;
+
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+              continue;
+            }
+          if (e == parent->right)
+            {
+              rotate_left (t, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          grandparent->red = true;
+          rotate_right (t, grandparent);
+        }
+      else
+        {
+          struct rb_elem *uncle = grandparent->left;
+
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+              continue;
+            }
+          if (e == parent->left)
+            {
+              rotate_right (t, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          grandparent->red = true;
+          rotate_left (t, grandparent);
+        }
+    }
+  t->root->red = false;
+}
+
+/* Restores the red-black properties after a black node was
+   removed from above X, which may be a leaf, so that the path
+   through X is one black node short.  PARENT is X's parent. */
+static void
+remove_fixup (struct rb_tree *t, struct rb_elem *x, struct rb_elem *parent)
+{
+  while (x != t->root && !is_red (x))
+    {
+      if (x == parent->left)
+        {
+          struct rb_elem *sibling = parent->right;
+
+          if (is_red (sibling))
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_left (t, parent);
+              sibling = parent->right;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              x = parent;
+              parent = x->parent;
+              continue;
+            }
+          if (!is_red (sibling->right))
+            {
+              sibling->left->red = false;
+              sibling->red = true;
+              rotate_right (t, sibling);
+              sibling = parent->right;
+            }
+          sibling->red = parent->red;
+          parent->red = false;
+          sibling->right->red = false;
+          rotate_left (t, parent);
+        }
+      else
+        {
+          struct rb_elem *sibling = parent->left;
+
+          if (is_red (sibling))
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_right (t, parent);
+              sibling = parent->left;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right))
+            {
+              sibling->red = true;
+              x = parent;
+              parent = x->parent;
+              continue;
+            }
+          if (!is_red (sibling->left))
+            {
+              sibling->right->red = false;
+              sibling->red = true;
+              rotate_left (t, sibling);
+              sibling = parent->left;
+            }
+          sibling->red = parent->red;
+          parent->red = false;
+          sibling->left->red = false;
+          rotate_right (t, parent);
+        }
+      x = t->root;
+    }
+  if (x != NULL)
+    x->red = false;
+}
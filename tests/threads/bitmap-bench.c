@@ -0,0 +1,132 @@
+/* Checks the word-at-a-time bitmap operations against a
+   bit-by-bit reference built on bitmap_test(), then times
+   bitmap_scan(), bitmap_count(), bitmap_contains() and
+   bitmap_set_multiple() on a map the size of a 4 GB page pool
+   that is full except for its last few bits.  The timings are
+   informational only. */
+
+#include <bitmap.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+
+#define CHECK_BITS 20000
+#define CHECK_ROUNDS 200
+#define BENCH_BITS (1 << 20)
+#define BENCH_ROUNDS 50
+
+static size_t
+ref_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  size_t i, n = 0;
+
+  for (i = start; i < start + cnt; i++)
+    if (bitmap_test (b, i) == value)
+      n++;
+  return n;
+}
+
+static size_t
+ref_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  size_t i;
+
+  if (cnt == 0)
+    return start;
+  for (i = start; i + cnt <= bitmap_size (b); i++)
+    if (ref_count (b, i, cnt, value) == cnt)
+      return i;
+  return BITMAP_ERROR;
+}
+
+static void
+check_against_reference (void) 
+{
+  struct bitmap *b = bitmap_create (CHECK_BITS);
+  int round;
+
+  if (b == NULL)
+    fail ("couldn't allocate bitmap");
+
+  for (round = 0; round < CHECK_ROUNDS; round++) 
+    {
+      size_t start = random_ulong () % CHECK_BITS;
+      size_t cnt = random_ulong () % (CHECK_BITS - start + 1);
+      bool value = random_ulong () & 1;
+      size_t want = random_ulong () % 8 + 1;
+
+      bitmap_set_multiple (b, start, cnt, value);
+      if (ref_count (b, start, cnt, value) != cnt)
+        fail ("bitmap_set_multiple (%zu, %zu) disagrees", start, cnt);
+
+      start = random_ulong () % CHECK_BITS;
+      cnt = random_ulong () % (CHECK_BITS - start + 1);
+      if (bitmap_count (b, start, cnt, value)
+          != ref_count (b, start, cnt, value))
+        fail ("bitmap_count (%zu, %zu) disagrees", start, cnt);
+      if (bitmap_contains (b, start, cnt, value)
+          != (ref_count (b, start, cnt, value) > 0))
+        fail ("bitmap_contains (%zu, %zu) disagrees", start, cnt);
+      if (bitmap_scan (b, start, want, value)
+          != ref_scan (b, start, want, value))
+        fail ("bitmap_scan (%zu, %zu) disagrees", start, want);
+    }
+  bitmap_destroy (b);
+  msg ("word operations agree with the bit-by-bit reference");
+}
+
+static void
+report (const char *what, int64_t start) 
+{
+  msg ("%s: %lld ticks", what, timer_elapsed (start));
+}
+
+void
+test_bitmap_bench (void) 
+{
+  struct bitmap *b;
+  size_t free_idx = BENCH_BITS - 3;
+  int64_t start;
+  int i;
+
+  random_init (0);
+  check_against_reference ();
+
+  b = bitmap_create (BENCH_BITS);
+  if (b == NULL)
+    fail ("couldn't allocate bitmap");
+  bitmap_set_all (b, true);
+  bitmap_reset (b, free_idx);
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_ROUNDS; i++)
+    if (bitmap_scan (b, 0, 1, false) != free_idx)
+      fail ("bitmap_scan missed the free bit");
+  report ("bitmap_scan, nearly full map", start);
+
+  start = timer_ticks ();
+  if (ref_scan (b, 0, 1, false) != free_idx)
+    fail ("reference scan missed the free bit");
+  report ("bit-by-bit scan, one round", start);
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_ROUNDS; i++)
+    if (bitmap_count (b, 0, BENCH_BITS, false) != 1)
+      fail ("bitmap_count miscounted");
+  report ("bitmap_count, whole map", start);
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_ROUNDS; i++)
+    if (bitmap_contains (b, 0, free_idx, false))
+      fail ("bitmap_contains found a phantom bit");
+  report ("bitmap_contains, whole map", start);
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_ROUNDS; i++)
+    bitmap_set_multiple (b, 1, BENCH_BITS - 2, i & 1);
+  report ("bitmap_set_multiple, whole map", start);
+
+  bitmap_destroy (b);
+  pass ();
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(bitmap-bench\) .*: \d+ ticks$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(bitmap-bench) begin
+(bitmap-bench) word operations agree with the bit-by-bit reference
+(bitmap-bench) PASS
+(bitmap-bench) end
+EOF
+pass;
@@ -0,0 +1,148 @@
+/* Fragments the user pool by filling it and then freeing every
+   other page, with the pages in between mapped into a page table
+   as user frames.  A multi-page user allocation must then succeed
+   by migrating frames out of the way, and every frame must still
+   be mapped at its old address with its contents intact. */
+
+#include <list.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "threads/mmu.h"
+#include "vm/vm.h"
+
+#define RUN_PAGES 4
+#define RUN_CNT 3
+#define FRAME_VA ((uint8_t *) 0x10000000)
+
+/* A free page held back until the pool is full. */
+struct hole
+  {
+    struct list_elem elem;
+  };
+
+/* A user page made up for the test, with a real frame. */
+struct fake
+  {
+    struct list_elem elem;
+    size_t no;
+    struct page page;
+  };
+
+static uint8_t
+pattern (size_t frame_no, size_t ofs)
+{
+  return (frame_no * 7 + ofs) & 0xff;
+}
+
+void
+test_palloc_compact (void) 
+{
+  struct thread *t = thread_current ();
+  struct list holes, fakes;
+  struct list_elem *e;
+  size_t frame_cnt = 0;
+  void *runs[RUN_CNT];
+  size_t i, j;
+  int index;
+
+  ASSERT (t->pml4 == NULL);
+  t->pml4 = pml4_create ();
+  list_init (&holes);
+  list_init (&fakes);
+
+  /* Take every user page.  Odd pages become user frames, even ones
+     are held so that the scan moves on, then freed together. */
+  for (;;) 
+    {
+      void *kva = palloc_get_page (PAL_USER);
+      if (kva == NULL)
+        break;
+      if (palloc_is_lent (kva)) 
+        {
+          palloc_free_page (kva);
+          break;
+        }
+      if (pg_no (kva) % 2 == 0) 
+        {
+          list_push_back (&holes, &((struct hole *) kva)->elem);
+          continue;
+        }
+
+      struct fake *fake = calloc (1, sizeof *fake);
+      struct page *page = &fake->page;
+      ASSERT (fake != NULL);
+      fake->no = frame_cnt++;
+      list_push_back (&fakes, &fake->elem);
+      page->va = FRAME_VA + fake->no * PGSIZE;
+      page->owner = t;
+      if (vm_test_frame (page, kva) == NULL)
+        fail ("out of memory making frame %zu", fake->no);
+      if (!pml4_set_page (t->pml4, page->va, kva, true))
+        fail ("out of memory mapping frame %zu", fake->no);
+      for (j = 0; j < PGSIZE; j++)
+        ((uint8_t *) kva)[j] = pattern (fake->no, j);
+    }
+  while (!list_empty (&holes))
+    palloc_free_page (list_pop_front (&holes));
+
+  index = palloc_frag_index (PAL_USER, RUN_PAGES);
+  msg ("fragmented the user pool");
+  if (index <= 500)
+    fail ("fragmentation index %d, expected above 500", index);
+
+  for (i = 0; i < RUN_CNT; i++) 
+    {
+      runs[i] = palloc_get_multiple (PAL_USER, RUN_PAGES);
+      if (runs[i] == NULL)
+        fail ("allocating run %zu failed", i);
+      if (palloc_is_lent (runs[i]))
+        fail ("run %zu was borrowed instead of compacted", i);
+    }
+  msg ("allocated %d runs of %d pages", RUN_CNT, RUN_PAGES);
+
+  for (e = list_begin (&fakes); e != list_end (&fakes); e = list_next (e)) 
+    {
+      struct fake *fake = list_entry (e, struct fake, elem);
+      struct page *page = &fake->page;
+      uint8_t *kva = pml4_get_page (t->pml4, page->va);
+
+      i = fake->no;
+      if (kva != page->frame->kva)
+        fail ("frame %zu: page table and frame table disagree", i);
+      for (j = 0; j < RUN_CNT; j++)
+        if (kva >= (uint8_t *) runs[j]
+            && kva < (uint8_t *) runs[j] + RUN_PAGES * PGSIZE)
+          fail ("frame %zu still inside run %zu", i, j);
+      for (j = 0; j < PGSIZE; j++)
+        if (kva[j] != pattern (i, j))
+          fail ("frame %zu: byte %zu corrupted", i, j);
+    }
+  msg ("all frames moved intact");
+
+  for (i = 0; i < RUN_CNT; i++)
+    palloc_free_multiple (runs[i], RUN_PAGES);
+  while (!list_empty (&fakes)) 
+    {
+      struct fake *fake = list_entry (list_pop_front (&fakes),
+                                      struct fake, elem);
+      vm_page_release_frame (&fake->page);
+      free (fake);
+    }
+  pml4_destroy (t->pml4);
+  t->pml4 = NULL;
+  pass ();
+}
+#else
+void
+test_palloc_compact (void) 
+{
+  msg ("fragmented the user pool");
+  msg ("compaction needs VM; skipped");
+  pass ();
+}
+#endif
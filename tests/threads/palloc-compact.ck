@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(palloc-compact) begin
+(palloc-compact) fragmented the user pool
+(palloc-compact) allocated 3 runs of 4 pages
+(palloc-compact) all frames moved intact
+(palloc-compact) PASS
+(palloc-compact) end
+EOF
+(palloc-compact) begin
+(palloc-compact) fragmented the user pool
+(palloc-compact) compaction needs VM; skipped
+(palloc-compact) PASS
+(palloc-compact) end
+EOF
+pass;
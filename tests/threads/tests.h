@@ -32,6 +32,8 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_bitmap_bench;
+extern test_func test_palloc_compact;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
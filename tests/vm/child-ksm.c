@@ -0,0 +1,47 @@
+/* Fills a 1 MB array with data that depends only on the page number,
+   so that every copy of this program holds the same pages, then
+   checks it over and over to give ksmd time to merge them.  Finally
+   writes to every 16th page and checks that only those changed.
+   Used by ksm-merge. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 256
+#define PASS_CNT 200
+
+static char buf[PAGE_COUNT * PAGE_SIZE];
+
+static char
+expected (size_t i, bool written)
+{
+  return written && i % (16 * PAGE_SIZE) == 0 ? 'w' : (char) (i / PAGE_SIZE + i % 7);
+}
+
+static void
+check (bool written)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof buf; i++)
+    if (buf[i] != expected (i, written))
+      fail ("byte %zu is %d, expected %d", i, buf[i], expected (i, written));
+}
+
+void
+test_main (void)
+{
+  size_t i, pass;
+
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = expected (i, false);
+  for (pass = 0; pass < PASS_CNT; pass++)
+    check (false);
+
+  for (i = 0; i < sizeof buf; i += 16 * PAGE_SIZE)
+    buf[i] = 'w';
+  check (true);
+  exit (0);
+}
@@ -0,0 +1,43 @@
+/* Checks a 1 MB read-only array that is stored in this program's
+   executable, four words per page, before making any system call,
+   so that its exec-to-main time includes faulting in all of it from
+   the file.  With an argument, checks it that many times, to stay
+   around while other copies of this program start.  Used by
+   fault-around, fault-around-off and text-share. */
+
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-text";
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 256
+#define PAGE_WORDS (PAGE_SIZE / sizeof (int))
+
+/* Page K starts with K + 1; everything else is zero. */
+#define P1(K) [(K) * PAGE_WORDS] = (K) + 1,
+#define P4(K) P1 (K) P1 ((K) + 1) P1 ((K) + 2) P1 ((K) + 3)
+#define P16(K) P4 (K) P4 ((K) + 4) P4 ((K) + 8) P4 ((K) + 12)
+#define P64(K) P16 (K) P16 ((K) + 16) P16 ((K) + 32) P16 ((K) + 48)
+
+static const int text[PAGE_COUNT * PAGE_WORDS] =
+  {
+    P64 (0) P64 (64) P64 (128) P64 (192)
+  };
+
+int
+main (int argc, char *argv[])
+{
+  int passes = argc > 1 ? atoi (argv[1]) : 1;
+  size_t i;
+
+  while (passes-- > 0)
+    for (i = 0; i < PAGE_COUNT * PAGE_WORDS; i += PAGE_WORDS / 4)
+      {
+        int expected = i % PAGE_WORDS == 0 ? (int) (i / PAGE_WORDS) + 1 : 0;
+        if (text[i] != expected)
+          fail ("word %zu is %d, expected %d", i, text[i], expected);
+      }
+  return 81;
+}
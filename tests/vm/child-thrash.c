@@ -0,0 +1,31 @@
+/* Sweeps a 4 MB array several times, checking on each pass that
+   every page still holds what the previous pass wrote into it.
+   Used by thrash-2proc. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (4 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+#define PASS_CNT 3
+
+static char big_chunk[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  size_t pass, i;
+
+  for (pass = 0; pass < PASS_CNT; pass++)
+    for (i = 0; i < PAGE_COUNT; i++)
+      {
+        char *mem = big_chunk + i * PAGE_SIZE;
+        if (pass > 0 && *mem != (char) (i + pass - 1))
+          fail ("page %zu is inconsistent on pass %zu", i, pass);
+        *mem = (char) (i + pass);
+      }
+  exit (0);
+}
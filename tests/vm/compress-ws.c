@@ -0,0 +1,55 @@
+/* Sweeps an 8 MB working set, several times larger than the user
+   memory the zswap-* tests allow, whose pages compress well: each
+   is one short text record, stamped with the page number and the
+   pass, repeated to fill the page.  Every pass checks what the
+   previous one wrote before rewriting the page.  The zswap-* tests
+   run this same program with and without the compressed swap pool,
+   and their .ck files report how many pages each wrote to the swap
+   disk. */
+
+#include "tests/vm/compress-ws.h"
+#include <stdio.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 2048
+#define PASS_CNT 3
+#define RECORD_SIZE 64
+
+static char ws[PAGE_COUNT * PAGE_SIZE];
+static char expected[PAGE_SIZE];
+
+/* Fills PAGE with the contents of page NO after pass PASS. */
+static void
+fill_page (char *page, size_t no, size_t pass)
+{
+  size_t i;
+
+  snprintf (page, RECORD_SIZE, "page %04zu, pass %zu: all work and no play",
+            no, pass);
+  for (i = RECORD_SIZE; i < PAGE_SIZE; i += RECORD_SIZE)
+    memcpy (page + i, page, RECORD_SIZE);
+}
+
+void
+compress_ws (void)
+{
+  size_t pass, no;
+
+  for (pass = 0; pass < PASS_CNT; pass++)
+    for (no = 0; no < PAGE_COUNT; no++)
+      {
+        char *page = ws + no * PAGE_SIZE;
+
+        if (pass > 0)
+          {
+            fill_page (expected, no, pass - 1);
+            if (memcmp (page, expected, PAGE_SIZE))
+              fail ("page %zu is inconsistent on pass %zu", no, pass);
+          }
+        fill_page (page, no, pass);
+      }
+  msg ("swept %d pages %d times", PAGE_COUNT, PASS_CNT);
+}
@@ -0,0 +1,6 @@
+#ifndef TESTS_VM_COMPRESS_WS
+#define TESTS_VM_COMPRESS_WS 1
+
+void compress_ws (void);
+
+#endif /* tests/vm/compress-ws.h */
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::vm_stats;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fault-around-off) begin
+(fault-around-off) end
+EOF
+pass (vm_stats_summary ("exec", qr/^Exec: \d+ programs .* in (\d+) ticks and (\d+) faults/,
+		   '%1$s: %3$d faults, %2$d ticks to first system call',
+		   on => "fault-around", off => "fault-around-off"));
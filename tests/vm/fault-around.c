@@ -0,0 +1,24 @@
+/* Runs child-text, whose 1 MB executable is faulted in from the
+   file system before it makes its first system call.  Built twice:
+   as fault-around, with the default fault-around window, and as
+   fault-around-off, with -fault-around=0.  The .ck files compare
+   the faults and time each took to get from exec to the child's
+   first system call. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pid_t child = fork ("child-text");
+
+  if (child == 0)
+    {
+      if (exec ("child-text") == -1)
+        fail ("exec \"child-text\"");
+    }
+  if (wait (child) != 81)
+    fail ("child-text saw the wrong data");
+}
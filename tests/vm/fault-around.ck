@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::vm_stats;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fault-around) begin
+(fault-around) end
+EOF
+my ($fa) = grep (/^Fault-around: \d+ pages/, read_text_file ("$test.output"));
+fail "missing fault-around statistics\n" if !defined $fa;
+my ($pages, $hits) = $fa =~ /^Fault-around: (\d+) pages, (\d+) hits/;
+fail "no pages were read around a fault\n" if $pages == 0;
+fail "none of the $pages pages read around a fault were used\n"
+  if $hits == 0;
+pass (vm_stats_summary ("exec", qr/^Exec: \d+ programs .* in (\d+) ticks and (\d+) faults/,
+		   '%1$s: %3$d faults, %2$d ticks to first system call',
+		   on => "fault-around", off => "fault-around-off")
+      . " ($pages pages read around)");
@@ -0,0 +1,52 @@
+/* Forks a process that has written to 64 MB of memory.  The child
+   checks that it sees all of the parent's data, writes to every
+   64th page and exits; the parent then checks that none of the
+   child's writes reached it.  With copy-on-write, fork() copies no
+   data and only the pages the child writes are ever duplicated. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024 * 1024)
+#define PAGE_SIZE 4096
+#define CHILD_STRIDE (64 * PAGE_SIZE)
+
+static char buf[SIZE];
+
+static char
+pattern (size_t ofs)
+{
+  return ofs / PAGE_SIZE * 7;
+}
+
+void
+test_main (void)
+{
+  size_t i;
+  pid_t child;
+
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    buf[i] = pattern (i);
+  msg ("wrote 64 MB");
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      for (i = 0; i < SIZE; i += PAGE_SIZE)
+        if (buf[i] != pattern (i))
+          fail ("child sees byte %zu as %d, expected %d",
+                i, buf[i], pattern (i));
+      for (i = 0; i < SIZE; i += CHILD_STRIDE)
+        buf[i] = ~pattern (i);
+      exit (0);
+    }
+
+  CHECK (wait (child) == 0, "wait for child");
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    if (buf[i] != pattern (i))
+      fail ("parent sees byte %zu as %d, expected %d",
+            i, buf[i], pattern (i));
+  msg ("parent's memory intact");
+}
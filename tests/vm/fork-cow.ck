@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fork-cow) begin
+(fork-cow) wrote 64 MB
+(fork-cow) wait for child
+(fork-cow) parent's memory intact
+(fork-cow) end
+EOF
+my ($fork) = grep (/^Fork: \d+ forks/, read_text_file ("$test.output"));
+fail "missing fork statistics\n" if !defined $fork;
+my ($forks, $ticks, $shared, $copied) =
+  $fork =~ /^Fork: (\d+) forks in (\d+) ticks, (\d+) frames shared, (\d+) copied on write/;
+# The parent's 16384 pages of data must be shared, and only the 256
+# the child writes (plus a few stack and data pages) copied.
+fail "only $shared frames shared at fork\n" if $shared < 16384;
+fail "$copied frames copied on write\n" if $copied > 1024;
+pass ("fork took $ticks ticks, $shared frames shared, $copied copied on write");
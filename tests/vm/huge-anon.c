@@ -0,0 +1,50 @@
+/* Writes every page of an 8 MB array with huge pages turned on, so
+   that the 2 MB ranges inside it are each mapped by one fault, and
+   reads it back.  Then drops a single page in the middle of one of
+   them with MADV_DONTNEED, which splits that huge page, and checks
+   that only the dropped page went back to zeros. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (8 * 1024 * 1024)
+#define PAGE_SIZE 4096
+#define HUGE_SIZE (2 * 1024 * 1024)
+
+static char buf[SIZE];
+
+/* The byte written to page I of BUF. */
+static char
+value (size_t i)
+{
+  return i % 127 + 1;
+}
+
+void
+test_main (void)
+{
+  uintptr_t first = ((uintptr_t) buf + HUGE_SIZE - 1) / HUGE_SIZE * HUGE_SIZE;
+  char *drop = (char *) first + HUGE_SIZE / 2;
+  size_t i;
+
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    buf[i] = value (i / PAGE_SIZE);
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    if (buf[i] != value (i / PAGE_SIZE))
+      fail ("page %zu is %d, expected %d", i / PAGE_SIZE, buf[i],
+            value (i / PAGE_SIZE));
+  msg ("wrote and read back 8 MB");
+
+  CHECK (madvise (drop, PAGE_SIZE, MADV_DONTNEED) == 0,
+         "madvise MADV_DONTNEED one page of a huge page");
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    {
+      char expected = buf + i == drop ? 0 : value (i / PAGE_SIZE);
+      if (buf[i] != expected)
+        fail ("page %zu is %d, expected %d", i / PAGE_SIZE, buf[i], expected);
+    }
+  msg ("only the dropped page is zero");
+}
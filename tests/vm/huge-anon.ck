@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::vm_stats;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(huge-anon) begin
+(huge-anon) wrote and read back 8 MB
+(huge-anon) madvise MADV_DONTNEED one page of a huge page
+(huge-anon) only the dropped page is zero
+(huge-anon) end
+EOF
+my ($huge, $tries, $rate, $split)
+  = vm_stat ($test, qr/^Huge: (\d+) of (\d+) eligible faults mapped 2 MB pages \((\d+)% hit rate\), (\d+) split/);
+fail "missing huge page statistics\n" if !defined $split;
+# The array holds three whole 2 MB ranges, at least.
+fail "only $huge faults mapped huge pages\n" if $huge < 3;
+fail "no huge page was split\n" if $split == 0;
+pass ("$huge of $tries faults mapped huge pages ($rate% hit rate), $split split");
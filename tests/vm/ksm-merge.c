@@ -0,0 +1,32 @@
+/* Runs four copies of child-ksm at once with same-page merging
+   turned on.  Their arrays hold identical pages, which ksmd should
+   merge while the children check them, and the children's writes
+   afterwards must not be seen by the others.  The .ck file reports
+   how many frames merging saved. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+
+void
+test_main (void)
+{
+  pid_t child[CHILD_CNT];
+  size_t i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      child[i] = fork ("child-ksm");
+      if (child[i] == 0)
+        {
+          if (exec ("child-ksm") == -1)
+            fail ("exec \"child-ksm\"");
+        }
+    }
+
+  for (i = 0; i < CHILD_CNT; i++)
+    if (wait (child[i]) != 0)
+      fail ("child %zu saw the wrong data", i);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-merge) begin
+(child-ksm) begin
+(child-ksm) begin
+(child-ksm) begin
+(child-ksm) begin
+(ksm-merge) end
+EOF
+my ($ksm) = grep (/^KSM: \d+ frames scanned/, read_text_file ("$test.output"));
+fail "missing KSM statistics\n" if !defined $ksm;
+my ($scanned, $saved) = $ksm =~ /^KSM: (\d+) frames scanned, (\d+) frames saved/;
+fail "no frames were merged ($scanned scanned)\n" if $saved == 0;
+pass ("$scanned frames scanned, $saved frames saved by merging");
@@ -0,0 +1,34 @@
+/* Sweeps 2 MB of anonymous memory, four times the 256 user pages
+   the test runs with, writing a different value to each page on
+   every pass and checking the one before.  Memory stays short the
+   whole time, so kswapd should do most of the evicting.  The .ck
+   file checks that it did some and reports how the evictions were
+   split between kswapd and the faulting process. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 512
+#define PASSES 3
+
+static char pages[PAGE_COUNT * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  size_t pass, i;
+
+  for (pass = 0; pass < PASSES; pass++)
+    for (i = 0; i < PAGE_COUNT; i++)
+      {
+        char *p = pages + i * PAGE_SIZE;
+        char expected = pass == 0 ? 0 : (char) (i + pass);
+
+        if (*p != expected)
+          fail ("page %zu holds %d on pass %zu", i, *p, pass);
+        *p = (char) (i + pass + 1);
+      }
+  msg ("swept %d pages %d times", PAGE_COUNT, PASSES);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::vm_stats;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(kswapd-reclaim) begin
+(kswapd-reclaim) swept 512 pages 3 times
+(kswapd-reclaim) end
+EOF
+my ($direct, $direct_frames, $wakeups, $kswapd_frames)
+  = vm_stat ($test, qr/^Reclaim: (\d+) direct reclaims freed (\d+) frames, kswapd woke (\d+) times and freed (\d+) frames/);
+fail "missing reclaim statistics\n" if !defined $kswapd_frames;
+fail "kswapd freed no frames\n" if $kswapd_frames == 0;
+pass ("kswapd freed $kswapd_frames frames in $wakeups wakeups, "
+      . "faults freed $direct_frames in $direct direct reclaims");
@@ -0,0 +1,75 @@
+/* Maps large.txt with MAP_POPULATE, then gives the mapping and a
+   region of anonymous memory each kind of madvise() advice.  The
+   contents must survive every hint but MADV_DONTNEED, after which
+   the mapping reads the file again and the anonymous memory reads
+   zeros.  The .ck file checks that the populated mapping was read in
+   before it was touched. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ANON_PAGES 16
+
+static char anon[ANON_PAGES * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+static char buf[PAGE_SIZE];
+
+/* Compares the SIZE bytes at MAP with the file open as HANDLE. */
+static void
+compare_file (const char *map, int handle, size_t size, const char *when)
+{
+  size_t ofs;
+
+  seek (handle, 0);
+  for (ofs = 0; ofs < size; ofs += PAGE_SIZE)
+    {
+      size_t n = size - ofs < PAGE_SIZE ? size - ofs : PAGE_SIZE;
+
+      if (read (handle, buf, n) != (int) n)
+        fail ("read \"large.txt\" at offset %zu", ofs);
+      if (memcmp (map + ofs, buf, n))
+        fail ("mapping differs from file at offset %zu %s", ofs, when);
+    }
+}
+
+void
+test_main (void)
+{
+  char *map = (char *) 0x10000000;
+  int handle;
+  size_t size, i;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  size = filesize (handle);
+  CHECK (mmap (map, size, 0 | MAP_POPULATE, handle, 0) == map,
+         "mmap \"large.txt\" with MAP_POPULATE");
+  compare_file (map, handle, size, "after MAP_POPULATE");
+
+  CHECK (madvise (map, size, MADV_SEQUENTIAL) == 0, "madvise MADV_SEQUENTIAL");
+  CHECK (madvise (map, size, MADV_DONTNEED) == 0, "madvise MADV_DONTNEED");
+  compare_file (map, handle, size, "read sequentially after MADV_DONTNEED");
+
+  CHECK (madvise (map, size, MADV_RANDOM) == 0, "madvise MADV_RANDOM");
+  CHECK (madvise (map, size, MADV_DONTNEED) == 0, "madvise MADV_DONTNEED");
+  CHECK (madvise (map, size, MADV_WILLNEED) == 0, "madvise MADV_WILLNEED");
+  compare_file (map, handle, size, "after MADV_WILLNEED");
+
+  memset (anon, 0x5a, sizeof anon);
+  CHECK (madvise (anon, sizeof anon, MADV_DONTNEED) == 0,
+         "madvise MADV_DONTNEED on anonymous memory");
+  for (i = 0; i < sizeof anon; i++)
+    if (anon[i] != 0)
+      fail ("byte %zu of anonymous memory is %02hhx after MADV_DONTNEED",
+            i, anon[i]);
+
+  CHECK (madvise ((void *) 0x20000000, PAGE_SIZE, MADV_WILLNEED) == -1,
+         "madvise unmapped memory");
+  CHECK (madvise (map + 1, PAGE_SIZE, MADV_NORMAL) == -1,
+         "madvise a misaligned address");
+  CHECK (madvise (map, PAGE_SIZE, 99) == -1, "madvise unknown advice");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-advise) begin
+(mmap-advise) open "large.txt"
+(mmap-advise) mmap "large.txt" with MAP_POPULATE
+(mmap-advise) madvise MADV_SEQUENTIAL
+(mmap-advise) madvise MADV_DONTNEED
+(mmap-advise) madvise MADV_RANDOM
+(mmap-advise) madvise MADV_DONTNEED
+(mmap-advise) madvise MADV_WILLNEED
+(mmap-advise) madvise MADV_DONTNEED on anonymous memory
+(mmap-advise) madvise unmapped memory
+(mmap-advise) madvise a misaligned address
+(mmap-advise) madvise unknown advice
+(mmap-advise) end
+EOF
+my ($advice) = grep (/^Advice: \d+ pages prefetched/, read_text_file ("$test.output"));
+fail "missing madvise statistics\n" if !defined $advice;
+my ($prefetched, $dropped) = $advice =~ /^Advice: (\d+) pages prefetched, (\d+) dropped/;
+fail "no pages were read in ahead of use\n" if $prefetched == 0;
+fail "no pages were dropped\n" if $dropped == 0;
+pass ("$prefetched pages prefetched, $dropped dropped");
@@ -0,0 +1,52 @@
+/* Maps small.txt, which takes three pages, across a 2 MB and a 1 GB
+   boundary, where the page tables, and the kernel's table of pages,
+   move on to a new table one or two levels up.  Changes one byte in
+   each page, unmaps both mappings and checks that the changes reached
+   the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[3 * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  char *maps[2] = { (char *) 0x201ff000, (char *) 0x3ffff000 };
+  int handles[2];
+  size_t size, ofs;
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      CHECK ((handles[i] = open ("small.txt")) > 1, "open \"small.txt\"");
+      CHECK (mmap (maps[i], filesize (handles[i]), 1, handles[i], 0) == maps[i],
+             "mmap \"small.txt\" at %p", maps[i]);
+    }
+  size = filesize (handles[0]);
+  if (size > sizeof buf)
+    fail ("\"small.txt\" is larger than %zu bytes", sizeof buf);
+
+  CHECK (read (handles[0], buf, size) == (int) size, "read \"small.txt\"");
+  for (i = 0; i < 2; i++)
+    if (memcmp (maps[i], buf, size))
+      fail ("mapping at %p differs from file", maps[i]);
+
+  /* The second mapping is unmapped last, so its pages win. */
+  for (i = 0; i < 2; i++)
+    for (ofs = 0; ofs < size; ofs += PAGE_SIZE)
+      maps[i][ofs] = 'a' + i;
+  for (i = 0; i < 2; i++)
+    munmap (maps[i]);
+  msg ("unmapped both");
+
+  seek (handles[0], 0);
+  CHECK (read (handles[0], buf, size) == (int) size, "read \"small.txt\" again");
+  for (ofs = 0; ofs < size; ofs += PAGE_SIZE)
+    if (buf[ofs] != 'b')
+      fail ("byte %zu of \"small.txt\" is '%c', not 'b'", ofs, buf[ofs]);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-span) begin
+(mmap-span) open "small.txt"
+(mmap-span) mmap "small.txt" at 0x201ff000
+(mmap-span) open "small.txt"
+(mmap-span) mmap "small.txt" at 0x3ffff000
+(mmap-span) read "small.txt"
+(mmap-span) unmapped both
+(mmap-span) read "small.txt" again
+(mmap-span) end
+EOF
+pass;
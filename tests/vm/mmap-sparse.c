@@ -0,0 +1,47 @@
+/* Maps large.txt and reads only every 64th page of it.  The kernel
+   keeps the mapping as one range, so the untouched pages must still
+   block an overlapping mapping, and unmapping must free the whole
+   range for a new one. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define STRIDE 64
+
+static char buf[PAGE_SIZE];
+
+void
+test_main (void)
+{
+  char *map = (char *) 0x10000000;
+  char *hole = map + 100 * PAGE_SIZE;
+  int handle, small;
+  size_t size, ofs;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  size = filesize (handle);
+  CHECK (mmap (map, size, 0, handle, 0) == map, "mmap \"large.txt\"");
+
+  for (ofs = 0; ofs < size; ofs += STRIDE * PAGE_SIZE)
+    {
+      size_t n = size - ofs < PAGE_SIZE ? size - ofs : PAGE_SIZE;
+
+      seek (handle, ofs);
+      if (read (handle, buf, n) != (int) n)
+        fail ("read \"large.txt\" at offset %zu", ofs);
+      if (memcmp (map + ofs, buf, n))
+        fail ("mapping differs from file at offset %zu", ofs);
+    }
+  msg ("read every %d pages", STRIDE);
+
+  CHECK ((small = open ("small.txt")) > 1, "open \"small.txt\"");
+  CHECK (mmap (hole, filesize (small), 0, small, 0) == MAP_FAILED,
+         "try to mmap \"small.txt\" over an untouched page");
+
+  munmap (map);
+  CHECK (mmap (hole, filesize (small), 0, small, 0) == hole,
+         "mmap \"small.txt\" after munmap");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-sparse) begin
+(mmap-sparse) open "large.txt"
+(mmap-sparse) mmap "large.txt"
+(mmap-sparse) read every 64 pages
+(mmap-sparse) open "small.txt"
+(mmap-sparse) try to mmap "small.txt" over an untouched page
+(mmap-sparse) mmap "small.txt" after munmap
+(mmap-sparse) end
+EOF
+pass;
@@ -0,0 +1,10 @@
+/* Replays the traces in trace-replay.c under the clock policy. */
+
+#include "tests/main.h"
+#include "tests/vm/trace-replay.h"
+
+void
+test_main (void)
+{
+  trace_replay ();
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::vm_stats;
+check_expected ([<<'EOF']);
+(replay-clock) begin
+(open "large.txt")
+(mmap "large.txt")
+(replayed hot-scan: 2912 page references)
+(replayed loop: 1200 page references)
+(replay-clock) end
+EOF
+pass (vm_stats_summary ("VM fault", qr/^VM: (\d+) major faults/, "%s: %d major faults",
+		   clock => "replay-clock", "2q" => "replay-2q"));
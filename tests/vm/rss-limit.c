@@ -0,0 +1,34 @@
+/* Writes every page of a 1 MB array with the resident set of each
+   process limited to 64 pages, so that the process has to evict its
+   own pages to swap to make room, and reads it back. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (1024 * 1024)
+#define PAGE_SIZE 4096
+
+static char buf[SIZE];
+
+/* The byte written to page I of BUF. */
+static char
+value (size_t i)
+{
+  return i % 127 + 1;
+}
+
+void
+test_main (void)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    buf[i] = value (i / PAGE_SIZE);
+  msg ("wrote 1 MB");
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    if (buf[i] != value (i / PAGE_SIZE))
+      fail ("page %zu is %d, expected %d", i / PAGE_SIZE, buf[i],
+            value (i / PAGE_SIZE));
+  msg ("read back 1 MB");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::vm_stats;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rss-limit) begin
+(rss-limit) wrote 1 MB
+(rss-limit) read back 1 MB
+(rss-limit) end
+EOF
+my ($peak, $ws, $major, $reclaimed)
+  = vm_stat ($test, qr/^Process rss-limit \(\d+\): RSS \d+ pages \(peak (\d+)\), working set (\d+) pages \(peak \d+\), (\d+) major faults, \d+ minor faults, (\d+) pages reclaimed/);
+fail "missing resident set statistics\n" if !defined $reclaimed;
+fail "resident set reached $peak pages, over the limit of 64\n" if $peak > 64;
+fail "no page was reclaimed\n" if $reclaimed == 0;
+fail "no page was read back from swap\n" if $major == 0;
+pass ("peak $peak pages, working set $ws pages, $reclaimed pages reclaimed");
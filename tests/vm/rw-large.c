@@ -0,0 +1,34 @@
+/* Writes a 64 kB buffer to a file with a single write() and reads
+   it back with a single read() into a buffer that starts in the
+   middle of a page, so that both calls copy across many pages of
+   user memory that have not been touched yet. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char out[SIZE];
+static char in[SIZE + 4096];
+
+void
+test_main (void)
+{
+  char *dst = in + 100;
+  int handle;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    out[i] = i % 251;
+  CHECK (create ("large.dat", SIZE), "create \"large.dat\"");
+  CHECK ((handle = open ("large.dat")) > 1, "open \"large.dat\"");
+  CHECK (write (handle, out, SIZE) == SIZE, "write 64 kB");
+  seek (handle, 0);
+  CHECK (read (handle, dst, SIZE) == SIZE, "read 64 kB");
+  for (i = 0; i < SIZE; i++)
+    if (dst[i] != out[i])
+      fail ("byte %zu is %d, expected %d", i, dst[i], out[i]);
+  msg ("compared 64 kB");
+  close (handle);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rw-large) begin
+(rw-large) create "large.dat"
+(rw-large) open "large.dat"
+(rw-large) write 64 kB
+(rw-large) read 64 kB
+(rw-large) compared 64 kB
+(rw-large) end
+EOF
+pass;
@@ -0,0 +1,32 @@
+/* Fills an array larger than user memory once, then reads it back
+   several times.  After the first pass every page that is evicted
+   again is unchanged since it was swapped in, so it should be
+   dropped without being written out a second time.  The .ck file
+   reports how many pages were written and how many were dropped. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 512
+#define READ_PASSES 4
+
+static uint8_t data[PAGE_COUNT * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  size_t pass, i;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    data[i * PAGE_SIZE] = (uint8_t) (i * 3 + 1);
+  msg ("filled %d pages", PAGE_COUNT);
+
+  for (pass = 0; pass < READ_PASSES; pass++)
+    for (i = 0; i < PAGE_COUNT; i++)
+      if (data[i * PAGE_SIZE] != (uint8_t) (i * 3 + 1))
+        fail ("page %zu changed on pass %zu", i, pass);
+  msg ("read %d pages %d times", PAGE_COUNT, READ_PASSES);
+}
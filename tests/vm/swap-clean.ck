@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected ([<<'EOF']);
+(swap-clean) begin
+(swap-clean) filled 512 pages
+(swap-clean) read 512 pages 4 times
+(swap-clean) end
+EOF
+my ($swap) = grep (/^Swap: \d+ pages out/, read_text_file ("$test.output"));
+fail "missing swap statistics\n" if !defined $swap;
+my ($out, $writes, $dropped) =
+  $swap =~ /^Swap: (\d+) pages out in (\d+) writes, (\d+) clean pages dropped/;
+fail "no clean pages were dropped ($out pages written)\n" if $dropped == 0;
+pass ("$out pages written in $writes writes, $dropped clean pages dropped");
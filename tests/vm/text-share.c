@@ -0,0 +1,32 @@
+/* Runs four copies of child-text at once.  Each checks the 1 MB of
+   read-only data in its executable many times, so the copies overlap
+   and the later ones should map the frames the first one loaded
+   instead of reading the file again.  The .ck file reports how many
+   faults were served that way. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+
+void
+test_main (void)
+{
+  pid_t child[CHILD_CNT];
+  size_t i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      child[i] = fork ("child-text");
+      if (child[i] == 0)
+        {
+          if (exec ("child-text 5000") == -1)
+            fail ("exec \"child-text\"");
+        }
+    }
+
+  for (i = 0; i < CHILD_CNT; i++)
+    if (wait (child[i]) != 81)
+      fail ("child %zu saw the wrong data", i);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::vm_stats;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(text-share) begin
+(text-share) end
+EOF
+my ($shared) = vm_stat ($test, qr/^Text: (\d+) faults mapped/);
+fail "missing text sharing statistics\n" if !defined $shared;
+fail "no executable pages were shared\n" if $shared == 0;
+pass ("$shared faults mapped executable pages already in memory");
@@ -0,0 +1,31 @@
+/* Runs two copies of child-thrash at once.  Their combined
+   working sets do not fit in memory, so the clock hand has to
+   evict frames that belong to the other process.  The .ck file
+   reports the number of major faults taken. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 2
+
+void
+test_main (void)
+{
+  pid_t child[CHILD_CNT];
+  size_t i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      child[i] = fork ("child-thrash");
+      if (child[i] == 0)
+        {
+          if (exec ("child-thrash") == -1)
+            fail ("exec \"child-thrash\"");
+        }
+    }
+
+  for (i = 0; i < CHILD_CNT; i++)
+    if (wait (child[i]) != 0)
+      fail ("child %zu lost data while thrashing", i);
+}
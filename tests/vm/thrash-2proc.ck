@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(thrash-2proc) begin
+(child-thrash) begin
+(child-thrash) begin
+(thrash-2proc) end
+EOF
+my (@output) = read_text_file ("$test.output");
+my ($stats) = grep (/^VM: \d+ major faults/, @output);
+fail "missing VM fault statistics\n" if !defined $stats;
+my ($major) = $stats =~ /^VM: (\d+) major faults/;
+my ($swap) = grep (/^Swap: \d+ pages out in \d+ writes/, @output);
+fail "missing swap statistics\n" if !defined $swap;
+my ($out, $writes) = $swap =~ /^Swap: (\d+) pages out in (\d+) writes/;
+my ($ra) = grep (/^Readahead: \d+ pages, \d+ hits, \d+ misses/, @output);
+fail "missing readahead statistics\n" if !defined $ra;
+my ($hits, $misses) = $ra =~ /^Readahead: \d+ pages, (\d+) hits, (\d+) misses/;
+pass ("$major major faults, $out pages swapped out in $writes writes, "
+      . "readahead $hits hits/$misses misses");
@@ -0,0 +1,121 @@
+/* Replays page reference traces against the kernel's page
+   replacement policy.  The replay-* tests run this same program
+   with different -vm-policy settings and a small -ul, and their
+   .ck files report the major fault count, so the policies' fault
+   rates on the same traces can be compared side by side.
+
+   Traces are stored run-length encoded: each step references
+   pages FIRST through FIRST + CNT - 1 of one region in order,
+   REPEAT times over.  Anonymous pages are written on every
+   reference and checked on the next one, so a policy bug that
+   loses data fails the test instead of just looking fast. */
+
+#include "tests/vm/trace-replay.h"
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HOT_PAGES 96            /* Small, frequently used set. */
+#define LOOP_PAGES 300          /* Cyclic set a bit larger than memory. */
+#define FILE_PAGES 488          /* Pages of large.txt. */
+
+enum region
+  {
+    HOT,                        /* Anonymous, in hot[]. */
+    LOOP,                       /* Anonymous, in loop[]. */
+    FILE,                       /* Read-only mapping of large.txt. */
+  };
+
+struct step
+  {
+    enum region region;
+    int first, cnt, repeat;
+  };
+
+struct trace
+  {
+    const char *name;
+    const struct step *steps;
+    size_t step_cnt;
+  };
+
+/* A hot working set interleaved with one-pass sequential scans of
+   a file: the scans must not push out the hot pages. */
+static const struct step hot_scan[] =
+  {
+    {HOT, 0, HOT_PAGES, 2}, {FILE, 0, FILE_PAGES, 1},
+    {HOT, 0, HOT_PAGES, 2}, {FILE, 0, FILE_PAGES, 1},
+    {HOT, 0, HOT_PAGES, 2}, {FILE, 0, FILE_PAGES, 1},
+    {HOT, 0, HOT_PAGES, 2}, {FILE, 0, FILE_PAGES, 1},
+    {HOT, 0, HOT_PAGES, 2},
+  };
+
+/* A loop slightly larger than memory, where LRU-like policies
+   fault on every reference. */
+static const struct step loop[] =
+  {
+    {LOOP, 0, LOOP_PAGES, 4},
+  };
+
+static const struct trace traces[] =
+  {
+    {"hot-scan", hot_scan, sizeof hot_scan / sizeof *hot_scan},
+    {"loop", loop, sizeof loop / sizeof *loop},
+  };
+
+static uint8_t hot_pages[HOT_PAGES * PAGE_SIZE];
+static uint8_t loop_pages[LOOP_PAGES * PAGE_SIZE];
+static uint8_t hot_seen[HOT_PAGES];
+static uint8_t loop_seen[LOOP_PAGES];
+
+/* References anonymous page NO of BASE, whose previous reference
+   (if any) left *SEEN in it. */
+static void
+touch_anon (uint8_t *base, uint8_t *seen, int no)
+{
+  uint8_t *p = base + (size_t) no * PAGE_SIZE;
+
+  if (*p != *seen)
+    fail ("page %d holds %d, expected %d", no, *p, *seen);
+  *seen = *p = (uint8_t) (*seen * 5 + no + 1);
+}
+
+void
+trace_replay (void)
+{
+  uint8_t *file = (uint8_t *) 0x10000000;
+  volatile uint8_t sink = 0;
+  int handle;
+  size_t t, s;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK (mmap (file, FILE_PAGES * PAGE_SIZE, 0, handle, 0) != MAP_FAILED,
+         "mmap \"large.txt\"");
+
+  for (t = 0; t < sizeof traces / sizeof *traces; t++)
+    {
+      const struct trace *trace = &traces[t];
+      size_t refs = 0;
+
+      for (s = 0; s < trace->step_cnt; s++)
+        {
+          const struct step *step = &trace->steps[s];
+          int r, i;
+
+          for (r = 0; r < step->repeat; r++)
+            for (i = step->first; i < step->first + step->cnt; i++)
+              {
+                if (step->region == HOT)
+                  touch_anon (hot_pages, &hot_seen[i], i);
+                else if (step->region == LOOP)
+                  touch_anon (loop_pages, &loop_seen[i], i);
+                else
+                  sink += file[(size_t) i * PAGE_SIZE];
+                refs++;
+              }
+        }
+      msg ("replayed %s: %zu page references", trace->name, refs);
+    }
+}
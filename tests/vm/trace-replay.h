@@ -0,0 +1,6 @@
+#ifndef TESTS_VM_TRACE_REPLAY
+#define TESTS_VM_TRACE_REPLAY 1
+
+void trace_replay (void);
+
+#endif /* tests/vm/trace-replay.h */
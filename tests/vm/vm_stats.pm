@@ -0,0 +1,41 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# Returns the numbers that RE captures from the first line of the
+# output of TEST it matches, or an empty list if TEST was not run.
+sub vm_stat {
+    my ($test, $re) = @_;
+    return () if ! -e "$test.output";
+    my ($line) = grep (/$re/, read_text_file ("$test.output"));
+    return () if !defined $line;
+    return $line =~ /$re/;
+}
+
+# Returns a summary of the numbers that RE captures from the output
+# of this test, which is one of several runs of the same workload,
+# compared against those of the other runs that have been made.
+# WHAT names the statistics for the error message if they are
+# missing.  FORMAT is given the name of a run and the numbers.  The
+# rest are pairs naming each run and its test, this one included.
+sub vm_stats_summary {
+    my ($what, $re, $format, @runs) = @_;
+    our ($test);
+    my (@own) = vm_stat ($test, $re);
+    fail "missing $what statistics\n" if !@own;
+
+    my (@others, $summary);
+    while (my ($name, $run) = splice (@runs, 0, 2)) {
+	(my $run_test = $test) =~ s{[^/]*$}{$run};
+	if ($run_test eq $test) {
+	    $summary = sprintf ($format, $name, @own);
+	    next;
+	}
+	my (@stats) = vm_stat ($run_test, $re);
+	push (@others, sprintf ($format, $name, @stats)) if @stats;
+    }
+    return join ("; ", $summary, @others);
+}
+
+1;
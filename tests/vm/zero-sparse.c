@@ -0,0 +1,33 @@
+/* Reads every page of a 32 MB array, then writes to one page in
+   256 and reads the whole array again.  Pages that are only read
+   should map the kernel's shared zero page instead of getting a
+   frame each, so the process fits in a 1 MB user pool and a swap
+   disk much smaller than the array. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (32 * 1024 * 1024)
+#define PAGE_SIZE 4096
+#define STRIDE (256 * PAGE_SIZE)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    if (buf[i] != 0)
+      fail ("byte %zu is %d, expected 0", i, buf[i]);
+  msg ("read 32 MB of zeros");
+
+  for (i = 0; i < SIZE; i += STRIDE)
+    buf[i] = 1;
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    if (buf[i] != (i % STRIDE == 0))
+      fail ("byte %zu is %d, expected %d", i, buf[i], i % STRIDE == 0);
+  msg ("wrote every 256th page");
+}
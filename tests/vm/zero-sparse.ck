@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected ([<<'EOF']);
+(zero-sparse) begin
+(zero-sparse) read 32 MB of zeros
+(zero-sparse) wrote every 256th page
+(zero-sparse) end
+EOF
+my (@output) = read_text_file ("$test.output");
+my ($stats) = grep (/^VM: \d+ major faults/, @output);
+fail "missing VM fault statistics\n" if !defined $stats;
+my ($zero) = $stats =~ /\((\d+) zero-page\)/;
+fail "missing zero-page count\n" if !defined $zero;
+# The array's 8192 pages are all read before any is written.  Only
+# one of them may share a page with initialized data.
+fail "only $zero faults mapped the zero page\n" if $zero < 8191;
+my ($swap) = grep (/^Swap: \d+ pages out/, @output);
+fail "missing swap statistics\n" if !defined $swap;
+my ($out) = $swap =~ /^Swap: (\d+) pages out/;
+pass ("$zero faults mapped the zero page, $out pages swapped out");
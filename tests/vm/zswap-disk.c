@@ -0,0 +1,12 @@
+/* Sweeps the compressible working set in compress-ws.c with every
+   swapped-out page going to the swap disk, for comparison with
+   zswap-ram. */
+
+#include "tests/main.h"
+#include "tests/vm/compress-ws.h"
+
+void
+test_main (void)
+{
+  compress_ws ();
+}
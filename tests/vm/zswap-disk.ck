@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::vm_stats;
+check_expected ([<<'EOF']);
+(zswap-disk) begin
+(zswap-disk) swept 2048 pages 3 times
+(zswap-disk) end
+EOF
+pass (vm_stats_summary ("swap", qr/^Swap: (\d+) pages out/, "%s: %d pages written to disk",
+		   ram => "zswap-ram", disk => "zswap-disk"));
@@ -0,0 +1,11 @@
+/* Sweeps the compressible working set in compress-ws.c with the
+   compressed swap pool turned on. */
+
+#include "tests/main.h"
+#include "tests/vm/compress-ws.h"
+
+void
+test_main (void)
+{
+  compress_ws ();
+}
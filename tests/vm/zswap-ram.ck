@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::vm_stats;
+our ($test);
+check_expected ([<<'EOF']);
+(zswap-ram) begin
+(zswap-ram) swept 2048 pages 3 times
+(zswap-ram) end
+EOF
+my ($zswap) = grep (/^Zswap: \d+ pages stored/, read_text_file ("$test.output"));
+fail "missing zswap statistics\n" if !defined $zswap;
+my ($stored) = $zswap =~ /^Zswap: (\d+) pages stored/;
+fail "no pages were stored compressed\n" if $stored == 0;
+pass (vm_stats_summary ("swap", qr/^Swap: (\d+) pages out/, "%s: %d pages written to disk",
+		   ram => "zswap-ram", disk => "zswap-disk")
+      . " ($stored stored compressed)");
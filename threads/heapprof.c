@@ -0,0 +1,285 @@
+#include "threads/heapprof.h"
+#ifdef HEAPPROF
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Kernel heap profiler.
+
+   Each allocator entry point reports the block it handed out
+   together with its caller's return address.  Blocks are kept in
+   an open-addressed table keyed by address, so that a free can be
+   charged back to the call site that made the allocation.  The
+   profiler must not allocate memory itself, so both tables live in
+   BSS and have a fixed size; allocations that do not fit are
+   counted but not tracked.
+
+   All state is protected by disabling interrupts, which keeps the
+   profiler usable from the keyboard interrupt handler. */
+
+#define SITE_CNT 512            /* Distinct call sites, power of 2. */
+#define RECORD_CNT 8192         /* Tracked live blocks, power of 2. */
+
+/* One allocating call site. */
+struct site {
+	void *caller;               /* Return address of the allocation. */
+	enum heapprof_kind kind;    /* Allocator that was called. */
+	size_t allocs;              /* Number of allocations. */
+	size_t frees;               /* Number of frees. */
+	size_t live_size;           /* Bytes (malloc) or pages (palloc). */
+	size_t peak_size;           /* Largest LIVE_SIZE seen. */
+};
+
+/* One live block. */
+struct record {
+	void *ptr;                  /* Block address, null if unused. */
+	size_t size;                /* Bytes or pages. */
+	struct site *site;          /* Where it was allocated. */
+	int64_t ticks;              /* When it was allocated. */
+	int tid;                    /* Allocating thread. */
+};
+
+static struct site sites[SITE_CNT];
+static size_t site_cnt;
+static struct record records[RECORD_CNT];
+static size_t record_cnt;
+static size_t dropped_cnt;
+
+/* Scratch space for heapprof_dump() and heapprof_report_leaks(). */
+#define LIVE_TID_CNT 64
+static struct site *sorted[SITE_CNT];
+static int live_tids[LIVE_TID_CNT];
+static size_t live_tid_cnt;
+static size_t leak_size[SITE_CNT];
+static size_t leak_cnt[SITE_CNT];
+static int64_t leak_since[SITE_CNT];
+
+static const char *kind_name[] = { "malloc", "palloc", "palloc/u" };
+
+static size_t
+hash_ptr (const void *p) {
+	return ((uintptr_t) p >> 4) * 0x9e3779b97f4a7c15ULL;
+}
+
+/* Returns the site for CALLER and KIND, creating it if needed.
+   Returns a null pointer if the site table is full. */
+static struct site *
+site_lookup (void *caller, enum heapprof_kind kind) {
+	size_t i = hash_ptr (caller) ^ kind;
+
+	for (;; i++) {
+		struct site *s = &sites[i & (SITE_CNT - 1)];
+		if (s->caller == caller && s->kind == kind)
+			return s;
+		if (s->caller == NULL) {
+			if (site_cnt >= SITE_CNT - 1)
+				return NULL;
+			site_cnt++;
+			s->caller = caller;
+			s->kind = kind;
+			return s;
+		}
+	}
+}
+
+/* Returns the slot holding P, or the empty slot where it would go. */
+static size_t
+record_slot (const void *p) {
+	size_t i = hash_ptr (p) & (RECORD_CNT - 1);
+
+	while (records[i].ptr != NULL && records[i].ptr != p)
+		i = (i + 1) & (RECORD_CNT - 1);
+	return i;
+}
+
+/* Empties slot I, shifting back the entries that probed past it
+   so that lookups never stop early at the hole. */
+static void
+record_remove (size_t i) {
+	size_t j = i;
+
+	records[i].ptr = NULL;
+	for (;;) {
+		size_t k;
+
+		j = (j + 1) & (RECORD_CNT - 1);
+		if (records[j].ptr == NULL)
+			break;
+		k = hash_ptr (records[j].ptr) & (RECORD_CNT - 1);
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		records[i] = records[j];
+		records[j].ptr = NULL;
+		i = j;
+	}
+	record_cnt--;
+}
+
+/* Charges block P of SIZE bytes (or pages) to CALLER. */
+void
+heapprof_alloc (void *p, size_t size, enum heapprof_kind kind, void *caller) {
+	enum intr_level old_level;
+	struct site *s;
+
+	if (p == NULL)
+		return;
+
+	old_level = intr_disable ();
+	s = site_lookup (caller, kind);
+	if (s == NULL || record_cnt >= RECORD_CNT * 3 / 4)
+		dropped_cnt++;
+	else {
+		struct record *r = &records[record_slot (p)];
+		if (r->ptr == NULL)
+			record_cnt++;
+		*r = (struct record) {
+			.ptr = p,
+			.size = size,
+			.site = s,
+			.ticks = timer_ticks (),
+			.tid = thread_tid (),
+		};
+		s->allocs++;
+		s->live_size += size;
+		if (s->live_size > s->peak_size)
+			s->peak_size = s->live_size;
+	}
+	intr_set_level (old_level);
+}
+
+/* Releases the charge for block P, if it was being tracked. */
+void
+heapprof_free (void *p) {
+	enum intr_level old_level;
+	size_t i;
+
+	if (p == NULL)
+		return;
+
+	old_level = intr_disable ();
+	i = record_slot (p);
+	if (records[i].ptr != NULL) {
+		struct site *s = records[i].site;
+		s->frees++;
+		s->live_size -= records[i].size;
+		record_remove (i);
+	}
+	intr_set_level (old_level);
+}
+
+/* Prints the first CNT entries of SORTED in the form that
+   `backtrace' accepts. */
+static void
+print_call_sites (size_t cnt) {
+	size_t i;
+
+	printf ("Call sites:");
+	for (i = 0; i < cnt; i++)
+		printf (" %p", sorted[i]->caller);
+	printf (".\n");
+}
+
+/* Prints every call site with memory still allocated, largest
+   first. */
+void
+heapprof_dump (void) {
+	enum intr_level old_level = intr_disable ();
+	size_t cnt = 0;
+	size_t i, j;
+
+	for (i = 0; i < SITE_CNT; i++) {
+		struct site *s = &sites[i];
+		if (s->caller == NULL || s->live_size == 0)
+			continue;
+
+		/* Insertion sort, by kind then live size. */
+		for (j = cnt++; j > 0; j--) {
+			struct site *t = sorted[j - 1];
+			if (t->kind < s->kind
+					|| (t->kind == s->kind && t->live_size >= s->live_size))
+				break;
+			sorted[j] = t;
+		}
+		sorted[j] = s;
+	}
+
+	printf ("Heap profile at tick %lld: %zu live blocks, %zu untracked\n",
+			timer_ticks (), record_cnt, dropped_cnt);
+	printf ("%-8s %-18s %12s %12s %10s %10s\n",
+			"kind", "caller", "live", "peak", "allocs", "frees");
+	for (i = 0; i < cnt; i++) {
+		struct site *s = sorted[i];
+		const char *unit = s->kind == HP_MALLOC ? "B" : "pg";
+		printf ("%-8s %-18p %10zu%-2s %10zu%-2s %10zu %10zu\n",
+				kind_name[s->kind], s->caller, s->live_size, unit,
+				s->peak_size, unit, s->allocs, s->frees);
+	}
+	print_call_sites (cnt);
+	intr_set_level (old_level);
+}
+
+/* Adds T to LIVE_TIDS. */
+static void
+note_live_tid (struct thread *t, void *aux UNUSED) {
+	if (live_tid_cnt < LIVE_TID_CNT)
+		live_tids[live_tid_cnt++] = t->tid;
+}
+
+/* Returns true if TID was seen by note_live_tid(). */
+static bool
+tid_is_live (int tid) {
+	size_t i;
+
+	for (i = 0; i < live_tid_cnt; i++)
+		if (live_tids[i] == tid)
+			return true;
+	return false;
+}
+
+/* Reports, by call site, the blocks still live at power off that
+   were allocated by threads that have exited since.  Memory that
+   one thread allocates and another frees, such as the pages a
+   forked child copies or the aux structs handed to the page fault
+   handler, is only reported if nobody freed it by then.  A cache
+   that outlives the thread that filled it, such as the closed
+   inode cache, shows up here too. */
+void
+heapprof_report_leaks (void) {
+	enum intr_level old_level = intr_disable ();
+	size_t cnt = 0;
+	size_t i;
+
+	live_tid_cnt = 0;
+	thread_foreach (note_live_tid, NULL);
+	memset (leak_size, 0, sizeof leak_size);
+	memset (leak_cnt, 0, sizeof leak_cnt);
+	for (i = 0; i < RECORD_CNT; i++) {
+		struct record *r = &records[i];
+		size_t s;
+
+		if (r->ptr == NULL || tid_is_live (r->tid))
+			continue;
+		s = r->site - sites;
+		if (leak_cnt[s]++ == 0 || r->ticks < leak_since[s])
+			leak_since[s] = r->ticks;
+		leak_size[s] += r->size;
+	}
+
+	for (i = 0; i < SITE_CNT; i++) {
+		if (leak_cnt[i] == 0)
+			continue;
+		printf ("heapprof: %zu %s in %zu %s blocks from %p still live"
+				" after their threads exited (oldest at tick %lld)\n", leak_size[i],
+				sites[i].kind == HP_MALLOC ? "bytes" : "pages", leak_cnt[i],
+				kind_name[sites[i].kind], sites[i].caller, leak_since[i]);
+		sorted[cnt++] = &sites[i];
+	}
+	if (cnt > 0)
+		print_call_sites (cnt);
+	intr_set_level (old_level);
+}
+#endif /* HEAPPROF */
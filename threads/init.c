@@ -17,10 +17,15 @@
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
+#include "threads/memmap.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/shrinker.h"
 #include "threads/thread.h"
+#ifdef HEAPPROF
+#include "threads/heapprof.h"
+#endif
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -31,6 +36,12 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/replace.h"
+#include "vm/ksm.h"
+#include "vm/zswap.h"
+#include "vm/file.h"
+#include "vm/kswapd.h"
+#include "vm/rss.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -49,6 +60,9 @@ static bool format_filesys;
 /* -q: Power off after kernel tasks complete? */
 bool power_off_when_done;
 
+/* -memmap: Dump the physical memory map at power off? */
+static bool memmap_at_power_off;
+
 bool thread_tests;
 
 static void bss_init (void);
@@ -99,6 +113,7 @@ main (void) {
 
 	exception_init ();
 	syscall_init ();
+	memmap_init ();
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
@@ -164,6 +179,9 @@ paging_init (uint64_t mem_end) {
 
 	// reload cr3
 	pml4_activate(0);
+
+	// tag TLB entries with the address space, when the CPU can.
+	pcid_init ();
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -220,11 +238,33 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-memmap"))
+			memmap_at_power_off = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-vm-policy")) {
+			if (value == NULL || !replace_select (value))
+				PANIC ("unknown page replacement policy `%s'", value);
+		}
+		else if (!strcmp (name, "-ksm"))
+			ksm_scan_pages = atoi (value);
+		else if (!strcmp (name, "-zswap"))
+			zswap_pool_pages = atoi (value);
+		else if (!strcmp (name, "-fault-around"))
+			fault_around_pages = atoi (value);
+		else if (!strcmp (name, "-kswapd"))
+			kswapd_low_pages = atoi (value);
+		else if (!strcmp (name, "-thp"))
+			thp_enabled = true;
+		else if (!strcmp (name, "-rss-limit"))
+			rss_limit_pages = atoi (value);
+		else if (!strcmp (name, "-ws-interval"))
+			ws_interval = atoi (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -233,6 +273,12 @@ parse_options (char **argv) {
 	return argv;
 }
 
+/* Prints the physical memory map. */
+static void
+run_memmap (char **argv UNUSED) {
+	memmap_dump ();
+}
+
 /* Runs the task specified in ARGV[1]. */
 static void
 run_task (char **argv) {
@@ -265,6 +311,7 @@ run_actions (char **argv) {
 	/* Table of supported actions. */
 	static const struct action actions[] = {
 		{"run", 2, run_task},
+		{"memmap", 1, run_memmap},
 #ifdef FILESYS
 		{"ls", 1, fsutil_ls},
 		{"cat", 2, fsutil_cat},
@@ -311,6 +358,7 @@ usage (void) {
 #else
 			"  run TEST           Run TEST.\n"
 #endif
+			"  memmap             Print the physical memory map.\n"
 #ifdef FILESYS
 			"  ls                 List files in the root directory.\n"
 			"  cat FILE           Print FILE to the console.\n"
@@ -325,8 +373,19 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -memmap            Print the physical memory map at power off.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -vm-policy=NAME    Use page replacement policy NAME (clock, 2q).\n"
+			"  -ksm=PAGES         Merge identical pages, scanning PAGES frames 10x/sec.\n"
+			"  -zswap=PAGES       Keep up to PAGES of compressed swap in memory.\n"
+			"  -fault-around=N    Read up to N more file pages on a fault (default 16).\n"
+			"  -kswapd=PAGES      Reclaim in the background below PAGES free pages (0: off).\n"
+			"  -thp               Map 2 MB anonymous ranges with huge pages.\n"
+			"  -rss-limit=PAGES   Make a process over PAGES resident pages evict its own.\n"
+			"  -ws-interval=TICKS Sample working sets every TICKS ticks (default 100, 0: off).\n"
 #endif
 			);
 	power_off ();
@@ -342,6 +401,8 @@ power_off (void) {
 #endif
 
 	print_stats ();
+	if (memmap_at_power_off)
+		memmap_dump ();
 
 	printf ("Powering off...\n");
 	outw (0x604, 0x2000);               /* Poweroff command for qemu */
@@ -358,7 +419,16 @@ print_stats (void) {
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
+	palloc_print_stats ();
+	shrinker_print_stats ();
+#ifdef VM
+	vm_print_stats ();
+#endif
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef HEAPPROF
+	heapprof_dump ();
+	heapprof_report_leaks ();
+#endif
 }
@@ -5,9 +5,14 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/shrinker.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#ifdef HEAPPROF
+#include "threads/heapprof.h"
+#endif
 
 /* A simple implementation of malloc().
 
@@ -26,7 +31,11 @@
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   and give the arena back to the page allocator.  Each descriptor
+   keeps up to SPARE_ARENAS such arenas instead, so that a size
+   class that keeps crossing a page boundary does not go to the
+   page allocator every time; the malloc shrinker gives them back
+   under memory pressure.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
@@ -39,9 +48,14 @@ struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
+	size_t spare_cnt;           /* Entirely free arenas kept. */
+	size_t arena_cnt;           /* Arenas in use, spares included. */
 	struct lock lock;           /* Lock. */
 };
 
+/* Entirely free arenas each descriptor keeps around. */
+#define SPARE_ARENAS 1
+
 /* Magic number for detecting arena corruption. */
 #define ARENA_MAGIC 0x9a548eed
 
@@ -60,9 +74,19 @@ struct block {
 /* Our set of descriptors. */
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
+static size_t big_page_cnt;     /* Pages held by big blocks. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void release_arena (struct arena *);
+static void count_big_pages (size_t page_cnt);
+static void *malloc_block (size_t size);
+static size_t malloc_shrink (size_t target);
+
+static struct shrinker malloc_shrinker = {
+	.name = "malloc arenas",
+	.shrink = malloc_shrink,
+};
 
 /* Initializes the malloc() descriptors. */
 void
@@ -77,12 +101,24 @@ malloc_init (void) {
 		list_init (&d->free_list);
 		lock_init (&d->lock);
 	}
+	shrinker_register (&malloc_shrinker);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) {
+	void *p = malloc_block (size);
+#ifdef HEAPPROF
+	heapprof_alloc (p, size, HP_MALLOC, __builtin_return_address (0));
+#endif
+	return p;
+}
+
+/* Does the work of malloc(), without charging the block to the
+   caller. */
+static void *
+malloc_block (size_t size) {
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
@@ -109,6 +145,7 @@ malloc (size_t size) {
 		a->magic = ARENA_MAGIC;
 		a->desc = NULL;
 		a->free_cnt = page_cnt;
+		count_big_pages (page_cnt);
 		return a + 1;
 	}
 
@@ -118,8 +155,11 @@ malloc (size_t size) {
 	if (list_empty (&d->free_list)) {
 		size_t i;
 
-		/* Allocate a page. */
+		/* Allocate a page.  Drop the lock meanwhile, as the page
+		   allocator may call our shrinker. */
+		lock_release (&d->lock);
 		a = palloc_get_page (0);
+		lock_acquire (&d->lock);
 		if (a == NULL) {
 			lock_release (&d->lock);
 			return NULL;
@@ -133,12 +173,15 @@ malloc (size_t size) {
 			struct block *b = arena_to_block (a, i);
 			list_push_back (&d->free_list, &b->free_elem);
 		}
+		d->spare_cnt++;
+		d->arena_cnt++;
 	}
 
 	/* Get a block from free list and return it. */
 	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
 	a = block_to_arena (b);
-	a->free_cnt--;
+	if (a->free_cnt-- == d->blocks_per_arena)
+		d->spare_cnt--;
 	lock_release (&d->lock);
 	return b;
 }
@@ -156,9 +199,12 @@ calloc (size_t a, size_t b) {
 		return NULL;
 
 	/* Allocate and zero memory. */
-	p = malloc (size);
+	p = malloc_block (size);
 	if (p != NULL)
 		memset (p, 0, size);
+#ifdef HEAPPROF
+	heapprof_alloc (p, size, HP_MALLOC, __builtin_return_address (0));
+#endif
 
 	return p;
 }
@@ -185,7 +231,11 @@ realloc (void *old_block, size_t new_size) {
 		free (old_block);
 		return NULL;
 	} else {
-		void *new_block = malloc (new_size);
+		void *new_block = malloc_block (new_size);
+#ifdef HEAPPROF
+		heapprof_alloc (new_block, new_size, HP_MALLOC,
+				__builtin_return_address (0));
+#endif
 		if (old_block != NULL && new_block != NULL) {
 			size_t old_size = block_size (old_block);
 			size_t min_size = new_size < old_size ? new_size : old_size;
@@ -200,6 +250,9 @@ realloc (void *old_block, size_t new_size) {
    malloc(), calloc(), or realloc(). */
 void
 free (void *p) {
+#ifdef HEAPPROF
+	heapprof_free (p);
+#endif
 	if (p != NULL) {
 		struct block *b = p;
 		struct arena *a = block_to_arena (b);
@@ -218,27 +271,128 @@ free (void *p) {
 			/* Add block to free list. */
 			list_push_front (&d->free_list, &b->free_elem);
 
-			/* If the arena is now entirely unused, free it. */
+			/* If the arena is now entirely unused, keep it as a
+			   spare or free it. */
 			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
 				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+				if (d->spare_cnt < SPARE_ARENAS)
+					d->spare_cnt++;
+				else
+					release_arena (a);
 			}
 
 			lock_release (&d->lock);
 		} else {
 			/* It's a big block.  Free its pages. */
+			count_big_pages (-a->free_cnt);
 			palloc_free_multiple (a, a->free_cnt);
 			return;
 		}
 	}
 }
 
+/* Frees block P like free(), but for shrinkers: never sleeps, and
+   gives an arena that becomes entirely free straight back to the
+   page allocator instead of keeping it as a spare.  Returns the
+   number of pages given back, or -1, leaving P allocated, if P's
+   descriptor is busy or P is a big block. */
+int
+free_nowait (void *p) {
+	struct block *b = p;
+	struct arena *a = block_to_arena (b);
+	struct desc *d = a->desc;
+	int released = 0;
+
+	if (d == NULL || !lock_try_acquire (&d->lock))
+		return -1;
+#ifdef HEAPPROF
+	heapprof_free (p);
+#endif
+#ifndef NDEBUG
+	memset (b, 0xcc, d->block_size);
+#endif
+	list_push_front (&d->free_list, &b->free_elem);
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		release_arena (a);
+		released = 1;
+	}
+	lock_release (&d->lock);
+	return released;
+}
+
+/* Removes the blocks of A, which must be entirely free, from its
+   descriptor's free list and gives A back to the page allocator.
+   The descriptor's lock must be held. */
+static void
+release_arena (struct arena *a) {
+	struct desc *d = a->desc;
+	size_t i;
+
+	ASSERT (a->free_cnt == d->blocks_per_arena);
+	for (i = 0; i < d->blocks_per_arena; i++) {
+		struct block *b = arena_to_block (a, i);
+		list_remove (&b->free_elem);
+	}
+	d->arena_cnt--;
+	palloc_free_page (a);
+}
+
+/* Adds PAGE_CNT, which may be "negative", to the big block page
+   count.  Big blocks are not covered by any descriptor lock. */
+static void
+count_big_pages (size_t page_cnt) {
+	enum intr_level old_level = intr_disable ();
+	big_page_cnt += page_cnt;
+	intr_set_level (old_level);
+}
+
+/* Returns the number of pages malloc() holds in arenas and in big
+   blocks.  Reads the counters without locking, for diagnostics. */
+void
+malloc_get_usage (size_t *arena_pages, size_t *big_pages) {
+	struct desc *d;
+
+	*arena_pages = 0;
+	for (d = descs; d < descs + desc_cnt; d++)
+		*arena_pages += d->arena_cnt;
+	*big_pages = big_page_cnt;
+}
+
+/* Shrinker: gives back up to TARGET spare arenas.  Descriptors
+   whose lock is busy are skipped. */
+static size_t
+malloc_shrink (size_t target) {
+	size_t freed = 0;
+	struct desc *d;
+
+	for (d = descs; d < descs + desc_cnt && freed < target; d++) {
+		struct list_elem *e;
+
+		if (d->spare_cnt == 0 || !lock_try_acquire (&d->lock))
+			continue;
+		e = list_begin (&d->free_list);
+		while (d->spare_cnt > 0 && freed < target
+				&& e != list_end (&d->free_list)) {
+			struct arena *a = block_to_arena (list_entry (e, struct block,
+						free_elem));
+
+			/* Step past all of A's blocks before releasing it. */
+			do
+				e = list_next (e);
+			while (e != list_end (&d->free_list)
+					&& pg_round_down (e) == (void *) a);
+			if (a->free_cnt == d->blocks_per_arena) {
+				release_arena (a);
+				d->spare_cnt--;
+				freed++;
+			}
+		}
+		lock_release (&d->lock);
+	}
+	return freed;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
@@ -0,0 +1,148 @@
+#include "threads/memmap.h"
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#ifdef FILESYS
+#include "filesys/fat.h"
+#endif
+#ifdef VM
+#include "vm/vm.h"
+#endif
+
+/* Pages per kind of owner. */
+struct owners {
+	size_t stacks;              /* One page per thread. */
+	size_t tables;              /* Page-table pages, PML4s included. */
+	size_t fdts;                /* File descriptor tables. */
+	size_t malloc;              /* Arenas and big blocks. */
+	size_t fat;                 /* In-memory FAT, carved from malloc. */
+	size_t anon;                /* VM frames holding anonymous pages. */
+	size_t file;                /* VM frames holding file pages. */
+	size_t other;               /* Frames being filled, or no VM. */
+};
+
+static void print_pool (const char *name, enum palloc_flags);
+static void count_thread (struct thread *, void *owners);
+static void print_process (struct thread *, void *aux);
+
+/* Prints the memory map.  Runs with interrupts off, so that it
+   sees a consistent picture and may be used from an interrupt
+   handler. */
+void
+memmap_dump (void) {
+	enum intr_level old_level = intr_disable ();
+	struct palloc_usage k, u;
+	struct owners o = { 0 };
+	size_t big_pages, known;
+
+	palloc_get_usage (0, &k);
+	palloc_get_usage (PAL_USER, &u);
+
+	printf ("Memory map at tick %lld:\n", timer_ticks ());
+	print_pool ("kernel", 0);
+	print_pool ("user", PAL_USER);
+
+	thread_foreach (count_thread, &o);
+	malloc_get_usage (&o.malloc, &big_pages);
+	o.malloc += big_pages;
+#ifdef FILESYS
+	o.fat = fat_memory_pages ();
+	o.malloc -= o.fat < o.malloc ? o.fat : o.malloc;
+#endif
+#ifdef VM
+	{
+		struct list_elem *e;
+
+		for (e = list_begin (&frame_table); e != list_end (&frame_table);
+				e = list_next (e)) {
+			struct frame *f = list_entry (e, struct frame, frame_elem);
+			if (f->page == NULL)
+				continue;
+			if (page_get_type (f->page) == VM_FILE)
+				o.file++;
+			else
+				o.anon++;
+		}
+	}
+#endif
+
+	/* Whatever is not accounted for: the kernel image, the pool
+	   bitmaps, frames in transit, user pages without VM, ... */
+	known = o.stacks + o.tables + o.fdts + o.malloc + o.fat + o.anon + o.file;
+	o.other = k.used + u.used > known ? k.used + u.used - known : 0;
+	printf ("  owners: %zu thread stacks, %zu page tables, %zu fd tables, "
+			"%zu malloc, %zu FAT, %zu user anon, %zu user file, "
+			"%zu other\n", o.stacks, o.tables, o.fdts, o.malloc, o.fat,
+			o.anon, o.file, o.other);
+
+	printf ("  %-5s %-16s %8s %8s %8s\n",
+			"tid", "process", "resident", "tables", "kernel");
+	thread_foreach (print_process, NULL);
+	intr_set_level (old_level);
+}
+
+/* Prints the usage and free run histogram of one pool. */
+static void
+print_pool (const char *name, enum palloc_flags flags) {
+	struct palloc_usage u;
+	int i, last = -1;
+
+	palloc_get_usage (flags, &u);
+	printf ("  %s pool: %zu/%zu pages used, %zu lent out\n",
+			name, u.used, u.total, u.lent);
+	for (i = 0; i < PALLOC_RUN_BUCKETS; i++)
+		if (u.runs[i] != 0)
+			last = i;
+	printf ("    free runs:");
+	for (i = 0; i <= last; i++)
+		printf (" %zu-%zu:%zu", (size_t) 1 << i, ((size_t) 2 << i) - 1,
+				u.runs[i]);
+	printf (last < 0 ? " none\n" : "\n");
+}
+
+/* Charges T's own pages to OWNERS_. */
+static void
+count_thread (struct thread *t, void *owners_) {
+	struct owners *o = owners_;
+
+	o->stacks++;
+	if (t->pml4 != NULL) {
+		size_t tables;
+
+		pml4_user_pages (t->pml4, &tables);
+		o->tables += tables + 1;
+	}
+	if (t->fdt != NULL)
+		o->fdts += FDT_PAGES;
+}
+
+/* Prints one line for T, if it is a user process. */
+static void
+print_process (struct thread *t, void *aux UNUSED) {
+	size_t resident, tables, kernel;
+
+	if (t->pml4 == NULL)
+		return;
+	resident = pml4_user_pages (t->pml4, &tables);
+	kernel = 1 + (t->fdt != NULL ? FDT_PAGES : 0);
+	printf ("  %-5d %-16s %8zu %8zu %8zu\n", t->tid, t->name, resident,
+			tables + 1, kernel);
+}
+
+/* Interrupt handler for int $0x45. */
+static void
+memmap_interrupt (struct intr_frame *f UNUSED) {
+	memmap_dump ();
+}
+
+/* Lets user programs, as well as the kernel, ask for a dump with
+   "int $0x45". */
+void
+memmap_init (void) {
+	intr_register_int (0x45, 3, INTR_OFF, memmap_interrupt,
+			"Dump memory map");
+}
@@ -2,19 +2,157 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Process-context identifiers.
+ * When the CPU supports PCIDs, every TLB entry is tagged with the
+ * PCID held in CR3[11:0], so switching between address spaces need
+ * not throw away the translations of the other ones.  PCID 0 belongs
+ * to base_pml4; the remaining identifiers are handed out to user
+ * page tables.  A page table always maps to the same slot, and a
+ * page table that finds its slot owned by someone else simply takes
+ * it over and flushes the stale entries on its first activation.
+ * That keeps the lookup O(1) and recycles identifiers for free when
+ * there are more live address spaces than PCIDs. */
+#define CR4_PCIDE (1UL << 17)	  /* CR4: enable PCIDs. */
+#define CR3_NOFLUSH (1UL << 63)	  /* CR3 load: keep the PCID's TLB entries. */
+#define CPUID_PCID (1U << 17)	  /* CPUID.01H:ECX. */
+#define CPUID_INVPCID (1U << 10) /* CPUID.(07H,0):EBX. */
+#define PCID_CNT 4096
+
+struct pcid_slot
+{
+	uint64_t *owner; /* Page table using this PCID, or NULL. */
+	bool stale;		 /* Entries were changed while inactive. */
+};
+
+static bool pcid_enabled;
+static bool invpcid_enabled;
+static struct pcid_slot pcid_slots[PCID_CNT];
+
+/* Returns the PCID slot that PML4 maps to. */
+static uint16_t
+pcid_of(uint64_t *pml4)
+{
+	return 1 + pg_no(pml4) % (PCID_CNT - 1);
+}
+
+/* Turns on PCIDs if the CPU supports them.  Must be called with
+ * base_pml4 active, since CR4.PCIDE can only be set while
+ * CR3[11:0] is zero. */
+void pcid_init(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+	if (!(ecx & CPUID_PCID))
+		return;
+
+	cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+	if (eax >= 7)
+	{
+		cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+		invpcid_enabled = (ebx & CPUID_INVPCID) != 0;
+	}
+
+	lcr4(rcr4() | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+/* Returns true if PML4 is the page table currently loaded in CR3. */
+static bool
+pml4_is_active(uint64_t *pml4)
+{
+	return PTE_ADDR(rcr3()) == vtop(pml4);
+}
+
+/* Drops the TLB entry for VA in PML4.  The active page table uses
+ * INVLPG.  An inactive one still may have entries cached under its
+ * PCID; INVPCID removes just that one, otherwise the whole PCID is
+ * flushed the next time PML4 is activated. */
+static void
+pml4_invalidate(uint64_t *pml4, const void *va)
+{
+	if (pml4_is_active(pml4))
+		invlpg((uint64_t)va);
+	else if (pcid_enabled)
+	{
+		struct pcid_slot *slot = &pcid_slots[pcid_of(pml4)];
+		if (slot->owner != pml4)
+			return;
+		if (invpcid_enabled)
+			invpcid(0, pcid_of(pml4), (uint64_t)va);
+		else
+			slot->stale = true;
+	}
+}
+
+/* Huge pages split back into small ones, for the statistics. */
+static size_t huge_split_cnt;
+
+/* Page table pages set aside for splitting huge pages, one for each
+ * huge page mapped, chained through their first word.  A huge page
+ * can then always be split, even when memory has run out in the
+ * middle of evicting one of its small pages. */
+static void *split_reserve;
+
+/* Sets PT aside for a later split. */
+static void
+split_reserve_push(void *pt)
+{
+	enum intr_level old_level = intr_disable();
+	*(void **)pt = split_reserve;
+	split_reserve = pt;
+	intr_set_level(old_level);
+}
+
+/* Takes back a page set aside by split_reserve_push(). */
+static void *
+split_reserve_pop(void)
+{
+	enum intr_level old_level = intr_disable();
+	void *pt = split_reserve;
+
+	ASSERT(pt != NULL);
+	split_reserve = *(void **)pt;
+	intr_set_level(old_level);
+	return pt;
+}
+
+/* Replaces the huge page that entry IDX of page directory PD maps
+ * by a page table mapping the same 2 MB with HPAGE_CNT small pages,
+ * each with the huge page's flags, so that they can be changed one
+ * at a time.  The table comes from the split reserve, so this
+ * cannot fail. */
+static void
+pgdir_split(uint64_t *pml4, uint64_t *pd, int idx, const uint64_t va)
+{
+	uint64_t pde = pd[idx];
+	uint64_t *pt = split_reserve_pop();
+
+	for (unsigned i = 0; i < HPAGE_CNT; i++)
+		pt[i] = (PTE_ADDR(pde) + i * PGSIZE) | (pde & PTE_FLAGS & ~PTE_PS);
+	pd[idx] = vtop(pt) | PTE_U | PTE_W | PTE_P;
+	pml4_invalidate(pml4, (void *)va);
+	huge_split_cnt++;
+}
+
+/* Anyone who asks for the page table entry of a small page inside a
+ * huge page gets one: the huge page is split first. */
 static uint64_t *
-pgdir_walk(uint64_t *pdp, const uint64_t va, int create)
+pgdir_walk(uint64_t *pml4, uint64_t *pdp, const uint64_t va, int create)
 {
 	int idx = PDX(va);
 	if (pdp)
 	{
 		uint64_t *pte = (uint64_t *)pdp[idx];
+		if (((uint64_t)pte & PTE_PS) && ((uint64_t)pte & PTE_P))
+			pgdir_split(pml4, pdp, idx, va);
 		if (!((uint64_t)pte & PTE_P))
 		{
 			if (create)
@@ -34,7 +172,7 @@ pgdir_walk(uint64_t *pdp, const uint64_t va, int create)
 }
 
 static uint64_t *
-pdpe_walk(uint64_t *pdpe, const uint64_t va, int create)
+pdpe_walk(uint64_t *pml4, uint64_t *pdpe, const uint64_t va, int create)
 {
 	uint64_t *pte = NULL;
 	int idx = PDPE(va);
@@ -58,7 +196,7 @@ pdpe_walk(uint64_t *pdpe, const uint64_t va, int create)
 			else
 				return NULL;
 		}
-		pte = pgdir_walk(ptov(PTE_ADDR(pdpe[idx])), va, create);
+		pte = pgdir_walk(pml4, ptov(PTE_ADDR(pdpe[idx])), va, create);
 	}
 	if (pte == NULL && allocated)
 	{
@@ -99,7 +237,7 @@ pml4e_walk(uint64_t *pml4e, const uint64_t va, int create)
 			else
 				return NULL;
 		}
-		pte = pdpe_walk(ptov(PTE_ADDR(pml4e[idx])), va, create);
+		pte = pdpe_walk(pml4e, ptov(PTE_ADDR(pml4e[idx])), va, create);
 	}
 	if (pte == NULL && allocated)
 	{
@@ -149,7 +287,8 @@ pgdir_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux,
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
 	{
 		uint64_t *pte = ptov((uint64_t *)pdp[i]);
-		if (((uint64_t)pte) & PTE_P)
+		/* A huge page has no page table entries to give FUNC. */
+		if ((((uint64_t)pte) & PTE_P) && !(pdp[i] & PTE_PS))
 			if (!pt_for_each((uint64_t *)PTE_ADDR(pte), func, aux,
 							 pml4_index, pdp_index, i))
 				return false;
@@ -203,7 +342,11 @@ pgdir_destroy(uint64_t *pdp)
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
 	{
 		uint64_t *pte = ptov((uint64_t *)pdp[i]);
-		if (((uint64_t)pte) & PTE_P)
+		/* The VM owns the frames of a huge page; only the page set
+		 * aside to split it goes back. */
+		if ((((uint64_t)pte) & PTE_P) && (pdp[i] & PTE_PS))
+			palloc_free_page(split_reserve_pop());
+		else if (((uint64_t)pte) & PTE_P)
 			pt_destroy(PTE_ADDR(pte));
 	}
 	palloc_free_page((void *)pdp);
@@ -221,6 +364,45 @@ pdpe_destroy(uint64_t *pdpe)
 	palloc_free_page((void *)pdpe);
 }
 
+/* Returns the number of user pages present in PML4, counting a
+ * huge page as HPAGE_CNT of them, and stores in *TABLE_CNT the
+ * number of page-table pages below PML4 that map them.  User space lives entirely under PML4 entry 0, which
+ * is also all that pml4_destroy() tears down. */
+size_t pml4_user_pages(uint64_t *pml4, size_t *table_cnt)
+{
+	size_t pages = 0;
+
+	*table_cnt = 0;
+	if (!(pml4[0] & PTE_P))
+		return 0;
+
+	uint64_t *pdp = ptov(PTE_ADDR(pml4[0]));
+	(*table_cnt)++;
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+	{
+		if (!(pdp[i] & PTE_P))
+			continue;
+		uint64_t *pd = ptov(PTE_ADDR(pdp[i]));
+		(*table_cnt)++;
+		for (unsigned j = 0; j < PGSIZE / sizeof(uint64_t *); j++)
+		{
+			if (!(pd[j] & PTE_P))
+				continue;
+			if (pd[j] & PTE_PS)
+			{
+				pages += HPAGE_CNT;
+				continue;
+			}
+			uint64_t *pt = ptov(PTE_ADDR(pd[j]));
+			(*table_cnt)++;
+			for (unsigned k = 0; k < PGSIZE / sizeof(uint64_t *); k++)
+				if (pt[k] & PTE_P)
+					pages++;
+		}
+	}
+	return pages;
+}
+
 /* Destroys pml4e, freeing all the pages it references. */
 void pml4_destroy(uint64_t *pml4)
 {
@@ -232,14 +414,132 @@ void pml4_destroy(uint64_t *pml4)
 	uint64_t *pdpe = ptov((uint64_t *)pml4[0]);
 	if (((uint64_t)pdpe) & PTE_P)
 		pdpe_destroy((void *)PTE_ADDR(pdpe));
+
+	/* The page may come back as another page table; make sure that
+	 * one does not inherit our TLB entries. */
+	if (pcid_slots[pcid_of(pml4)].owner == pml4)
+		pcid_slots[pcid_of(pml4)].owner = NULL;
 	palloc_free_page((void *)pml4);
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  With PCIDs the entries cached for PML4 survive the
+ * switch, unless the slot was just taken over or marked stale. */
 void pml4_activate(uint64_t *pml4)
 {
-	lcr3(vtop(pml4 ? pml4 : base_pml4));
+	if (!pcid_enabled || pml4 == NULL || pml4 == base_pml4)
+	{
+		lcr3(vtop(pml4 ? pml4 : base_pml4) | (pcid_enabled ? CR3_NOFLUSH : 0));
+		return;
+	}
+
+	uint16_t pcid = pcid_of(pml4);
+	struct pcid_slot *slot = &pcid_slots[pcid];
+	bool flush = slot->owner != pml4 || slot->stale;
+
+	slot->owner = pml4;
+	slot->stale = false;
+	lcr3(vtop(pml4) | pcid | (flush ? 0 : CR3_NOFLUSH));
+}
+
+/* Returns the page directory entry of PML4 for VA, or a null
+ * pointer if there is no page directory for VA. */
+static uint64_t *
+pml4_pde(uint64_t *pml4, const void *va)
+{
+	uint64_t *pdp, *pd;
+
+	if (!(pml4[PML4(va)] & PTE_P))
+		return NULL;
+	pdp = ptov(PTE_ADDR(pml4[PML4(va)]));
+	if (!(pdp[PDPE(va)] & PTE_P))
+		return NULL;
+	pd = ptov(PTE_ADDR(pdp[PDPE(va)]));
+	return &pd[PDX(va)];
+}
+
+/* Returns the page directory entry of PML4 that maps the huge page
+ * holding VA, or a null pointer if VA is not in a huge page.  Unlike
+ * pml4e_walk(), this never splits the huge page. */
+static uint64_t *
+pml4_huge_pde(uint64_t *pml4, const void *va)
+{
+	uint64_t *pde = pml4_pde(pml4, va);
+
+	if (pde == NULL || (*pde & (PTE_P | PTE_PS)) != (PTE_P | PTE_PS))
+		return NULL;
+	return pde;
+}
+
+/* Returns the entry that holds the accessed and dirty bits of VA in
+ * PML4: its huge page's directory entry if it is in one, otherwise
+ * its page table entry or a null pointer.
+ *
+ * The small pages of a huge page share its one pair of bits, so each
+ * of them reads as accessed or dirty if any of them is, and clearing
+ * a bit through one clears it for all.  Splitting instead would undo
+ * every huge page on the first pass of the replacement policy or the
+ * working set sampler.  The cost is that clean small pages of a
+ * written huge page go to swap as if dirty, and that replacement
+ * ages a huge page's small pages together. */
+static uint64_t *
+pml4_hint_entry(uint64_t *pml4, const void *va)
+{
+	uint64_t *pde = pml4_huge_pde(pml4, va);
+
+	return pde != NULL ? pde : pml4e_walk(pml4, (uint64_t)va, false);
+}
+
+/* Maps the HPAGE_SIZE bytes of user virtual memory at UPAGE to the
+ * physically contiguous frames at KPAGE with a single huge page.
+ * Both must be HPAGE_SIZE-aligned.  Nothing in the range may be
+ * mapped yet.  Returns false if memory runs out or something is. */
+bool pml4_set_huge_page(uint64_t *pml4, void *upage, void *kpage, bool rw)
+{
+	uint64_t *pde;
+
+	ASSERT(((uint64_t)upage & (HPAGE_SIZE - 1)) == 0);
+	ASSERT(((uint64_t)kpage & (HPAGE_SIZE - 1)) == 0);
+	ASSERT(is_user_vaddr(upage));
+	ASSERT(pml4 != base_pml4);
+
+	/* Walking to the first small page makes the page directory; the
+	 * page table under it, new or left empty by earlier unmappings,
+	 * is then given up for the huge page. */
+	if (pml4e_walk(pml4, (uint64_t)upage, true) == NULL)
+		return false;
+	pde = pml4_pde(pml4, upage);
+
+	uint64_t *pt = ptov(PTE_ADDR(*pde));
+	for (unsigned i = 0; i < HPAGE_CNT; i++)
+		if (pt[i] & PTE_P)
+			return false;
+	*pde = vtop(kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	/* Keep the emptied table for splitting this huge page later. */
+	split_reserve_push(pt);
+	pml4_invalidate(pml4, upage);
+	return true;
+}
+
+/* Removes the huge page mapping UPAGE from PML4 all at once, without
+ * splitting it.  Does nothing if UPAGE does not start a huge page.
+ * The frames are the caller's. */
+void pml4_clear_huge_page(uint64_t *pml4, void *upage)
+{
+	uint64_t *pde = pml4_huge_pde(pml4, upage);
+
+	if (pde != NULL && ((uint64_t)upage & (HPAGE_SIZE - 1)) == 0)
+	{
+		*pde = 0;
+		pml4_invalidate(pml4, upage);
+		palloc_free_page(split_reserve_pop());
+	}
+}
+
+/* Returns the number of huge pages split so far. */
+size_t pml4_huge_splits(void)
+{
+	return huge_split_cnt;
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -251,6 +551,10 @@ pml4_get_page(uint64_t *pml4, const void *uaddr)
 {
 	ASSERT(is_user_vaddr(uaddr));
 
+	uint64_t *pde = pml4_huge_pde(pml4, uaddr);
+	if (pde != NULL)
+		return ptov(PTE_ADDR(*pde)) + ((uint64_t)uaddr & (HPAGE_SIZE - 1));
+
 	uint64_t *pte = pml4e_walk(pml4, (uint64_t)uaddr, 0);
 
 	if (pte && (*pte & PTE_P))
@@ -260,7 +564,9 @@ pml4_get_page(uint64_t *pml4, const void *uaddr)
 
 /* Adds a mapping in page map level 4 PML4 from user virtual page
  * UPAGE to the physical frame identified by kernel virtual address KPAGE.
- * UPAGE must not already be mapped. KPAGE should probably be a page obtained
+ * If UPAGE is already mapped, the old mapping is replaced and its TLB
+ * entry dropped; the frame it mapped is the caller's to keep or free.
+ * UPAGE is split out of a huge page if it lies in one. KPAGE should probably be a page obtained
  * from the user pool with palloc_get_page().
  * If WRITABLE is true, the new page is read/write;
  * otherwise it is read-only.
@@ -276,7 +582,12 @@ bool pml4_set_page(uint64_t *pml4, void *upage, void *kpage, bool rw)
 	uint64_t *pte = pml4e_walk(pml4, (uint64_t)upage, 1);
 
 	if (pte)
+	{
+		bool was_present = (*pte & PTE_P) != 0;
 		*pte = vtop(kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		if (was_present)
+			pml4_invalidate(pml4, upage);
+	}
 	return pte != NULL;
 }
 
@@ -295,18 +606,18 @@ void pml4_clear_page(uint64_t *pml4, void *upage)
 	if (pte != NULL && (*pte & PTE_P) != 0)
 	{
 		*pte &= ~PTE_P;
-		if (rcr3() == vtop(pml4))
-			invlpg((uint64_t)upage);
+		pml4_invalidate(pml4, upage);
 	}
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PML4 is dirty,
  * that is, if the page has been modified since the PTE was
- * installed.
+ * installed.  Inside a huge page, true if any of its pages is (see
+ * pml4_hint_entry()).
  * Returns false if PML4 contains no PTE for VPAGE. */
 bool pml4_is_dirty(uint64_t *pml4, const void *vpage)
 {
-	uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+	uint64_t *pte = pml4_hint_entry(pml4, vpage);
 	return pte != NULL && (*pte & PTE_D) != 0;
 }
 
@@ -314,7 +625,7 @@ bool pml4_is_dirty(uint64_t *pml4, const void *vpage)
  * in PML4. */
 void pml4_set_dirty(uint64_t *pml4, const void *vpage, bool dirty)
 {
-	uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+	uint64_t *pte = pml4_hint_entry(pml4, vpage);
 	if (pte)
 	{
 		if (dirty)
@@ -322,18 +633,18 @@ void pml4_set_dirty(uint64_t *pml4, const void *vpage, bool dirty)
 		else
 			*pte &= ~(uint32_t)PTE_D;
 
-		if (rcr3() == vtop(pml4))
-			invlpg((uint64_t)vpage);
+		pml4_invalidate(pml4, vpage);
 	}
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PML4 has been
  * accessed recently, that is, between the time the PTE was
- * installed and the last time it was cleared.  Returns false if
- * PML4 contains no PTE for VPAGE. */
+ * installed and the last time it was cleared.  Inside a huge page,
+ * true if any of its pages is (see pml4_hint_entry()).  Returns
+ * false if PML4 contains no PTE for VPAGE. */
 bool pml4_is_accessed(uint64_t *pml4, const void *vpage)
 {
-	uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+	uint64_t *pte = pml4_hint_entry(pml4, vpage);
 	return pte != NULL && (*pte & PTE_A) != 0;
 }
 
@@ -341,7 +652,7 @@ bool pml4_is_accessed(uint64_t *pml4, const void *vpage)
    VPAGE in PD. */
 void pml4_set_accessed(uint64_t *pml4, const void *vpage, bool accessed)
 {
-	uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
+	uint64_t *pte = pml4_hint_entry(pml4, vpage);
 	if (pte)
 	{
 		if (accessed)
@@ -349,7 +660,6 @@ void pml4_set_accessed(uint64_t *pml4, const void *vpage, bool accessed)
 		else
 			*pte &= ~(uint32_t)PTE_A;
 
-		if (rcr3() == vtop(pml4))
-			invlpg((uint64_t)vpage);
+		pml4_invalidate(pml4, vpage);
 	}
 }
@@ -8,9 +8,17 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/shrinker.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#ifdef HEAPPROF
+#include "threads/heapprof.h"
+#endif
+#ifdef VM
+#include "vm/vm.h"
+#endif
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
@@ -24,13 +32,40 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   The split is not a hard wall, though.  When a pool runs dry, it
+   borrows free pages from the other one as long as that leaves
+   the lender above its high watermark.  Borrowed pages are marked
+   in the lender's lent_map and go back to it when freed.  Once a
+   lender drops below its low watermark it wants its pages back;
+   palloc_reclaim_wanted() tells the VM how many user frames it
+   should evict from the kernel pool to get there.
+
+   A multi-page request can also fail with plenty of free pages
+   left, if they are scattered.  With VM, user frames can be moved
+   to another physical page, so as a last resort the allocator
+   migrates the frames out of the cheapest window and hands the
+   window out, before it turns to borrowing.  palloc_frag_index()
+   tells how much a failure of a given size would be due to
+   fragmentation rather than to a lack of memory.
+
+   If all of that fails, the registered shrinkers are asked to
+   give back cached memory, and the request is tried once more. */
 
 /* A memory pool. */
 struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
+	struct bitmap *lent_map;        /* Pages lent to the other pool. */
+	struct bitmap *movable_map;     /* Scratch for compact_pool(). */
 	uint8_t *base;                  /* Base of pool. */
+	size_t free_cnt;                /* Number of free pages. */
+	size_t lent_cnt;                /* Number of pages lent out. */
+	size_t low_water;               /* Reclaim lent pages below this. */
+	size_t high_water;              /* Lend only above this. */
+	size_t compact_cnt;             /* Successful compaction passes. */
+	size_t migrate_cnt;             /* Frames migrated by them. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +77,15 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void *get_pages (enum palloc_flags, size_t page_cnt);
+static size_t find_pages (struct pool **, struct pool *lender,
+		size_t page_cnt);
+static size_t take_pages (struct pool *, size_t page_cnt, bool lend);
+static void set_watermarks (struct pool *);
+#ifdef VM
+static size_t compact_pool (struct pool *, size_t page_cnt);
+static void mark_movable (void *page, void *pool);
+#endif
 
 /* multiboot info */
 struct multiboot_info {
@@ -250,6 +294,8 @@ palloc_init (void) {
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
 	populate_pools (&base_mem, &ext_mem);
+	set_watermarks (&kernel_pool);
+	set_watermarks (&user_pool);
 	return ext_mem.end;
 }
 
@@ -261,11 +307,30 @@ palloc_init (void) {
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
+	void *pages = get_pages (flags, page_cnt);
+#ifdef HEAPPROF
+	heapprof_alloc (pages, page_cnt,
+			flags & PAL_USER ? HP_PALLOC_USER : HP_PALLOC_KERNEL,
+			__builtin_return_address (0));
+#endif
+	return pages;
+}
+
+/* Does the work of palloc_get_multiple(), without charging the
+   pages to the caller. */
+static void *
+get_pages (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	struct pool *lender = flags & PAL_USER ? &kernel_pool : &user_pool;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	/* -ul caps user memory, so the kernel pool must not make up
+	   the difference. */
+	if ((flags & PAL_USER) && user_page_limit != SIZE_MAX)
+		lender = NULL;
+
+	size_t page_idx = find_pages (&pool, lender, page_cnt);
+	if (page_idx == BITMAP_ERROR && shrink_caches (page_cnt) > 0)
+		page_idx = find_pages (&pool, lender, page_cnt);
 	void *pages;
 
 	if (page_idx != BITMAP_ERROR)
@@ -284,6 +349,27 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	return pages;
 }
 
+/* Allocates PAGE_CNT contiguous pages from *POOL, or failing
+   that from LENDER, if not null, in which case *POOL is set to
+   LENDER.  Returns the index of the first page, or BITMAP_ERROR. */
+static size_t
+find_pages (struct pool **pool, struct pool *lender, size_t page_cnt) {
+	size_t page_idx = take_pages (*pool, page_cnt, false);
+#ifdef VM
+	/* Scattered free pages of our own are better than the other
+	   pool's: compact before borrowing. */
+	if (page_idx == BITMAP_ERROR && page_cnt > 1)
+		page_idx = compact_pool (*pool, page_cnt);
+#endif
+	if (page_idx == BITMAP_ERROR && lender != NULL) {
+		/* Out of our own pages: borrow from the other pool. */
+		page_idx = take_pages (lender, page_cnt, true);
+		if (page_idx != BITMAP_ERROR)
+			*pool = lender;
+	}
+	return page_idx;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -293,7 +379,56 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_page (enum palloc_flags flags) {
-	return palloc_get_multiple (flags, 1);
+	void *page = get_pages (flags, 1);
+#ifdef HEAPPROF
+	heapprof_alloc (page, 1,
+			flags & PAL_USER ? HP_PALLOC_USER : HP_PALLOC_KERNEL,
+			__builtin_return_address (0));
+#endif
+	return page;
+}
+
+/* Obtains PAGE_CNT contiguous free pages, PAGE_CNT being a power
+   of 2, whose address is a multiple of PAGE_CNT pages, so that one
+   large page table entry can map them all.  FLAGS works as for
+   palloc_get_multiple(), but the pages only come from the pool it
+   selects: neither borrowing nor compaction is tried, since the
+   caller can always fall back to ordinary pages.  The block is
+   freed a page at a time, so it is not charged to a call site. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t size = bitmap_size (pool->used_map);
+	size_t page_idx = BITMAP_ERROR;
+	size_t i;
+
+	ASSERT (page_cnt > 0 && (page_cnt & (page_cnt - 1)) == 0);
+
+	lock_acquire (&pool->lock);
+	/* The first index whose page starts an aligned block. */
+	i = (page_cnt - pg_no (pool->base) % page_cnt) % page_cnt;
+	for (; i + page_cnt <= size; i += page_cnt)
+		if (bitmap_none (pool->used_map, i, page_cnt)) {
+			page_idx = i;
+			break;
+		}
+	if (page_idx != BITMAP_ERROR) {
+		enum intr_level old_level = intr_disable ();
+		bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+		pool->free_cnt -= page_cnt;
+		intr_set_level (old_level);
+	}
+	lock_release (&pool->lock);
+
+	if (page_idx == BITMAP_ERROR) {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get_aligned: out of pages");
+		return NULL;
+	}
+	void *pages = pool->base + PGSIZE * page_idx;
+	if (flags & PAL_ZERO)
+		memset (pages, 0, PGSIZE * page_cnt);
+	return pages;
 }
 
 /* Frees the PAGE_CNT pages starting at PAGES. */
@@ -305,6 +440,9 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
 		return;
+#ifdef HEAPPROF
+	heapprof_free (pages);
+#endif
 
 	if (page_from_pool (&kernel_pool, pages))
 		pool = &kernel_pool;
@@ -319,7 +457,17 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+
+	/* Counters are also updated from the scheduler, which frees
+	   dying threads' pages and must not block on the pool lock. */
+	enum intr_level old_level = intr_disable ();
+	if (bitmap_test (pool->lent_map, page_idx)) {
+		bitmap_set_multiple (pool->lent_map, page_idx, page_cnt, false);
+		pool->lent_cnt -= page_cnt;
+	}
+	pool->free_cnt += page_cnt;
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +476,256 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages the pool selected by FLAGS wants
+   back from the other pool: nonzero only while it is below its
+   low watermark and has pages lent out. */
+size_t
+palloc_reclaim_wanted (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t want;
+
+	if (pool->free_cnt >= pool->low_water || pool->lent_cnt == 0)
+		return 0;
+	want = pool->high_water - pool->free_cnt;
+	return want < pool->lent_cnt ? want : pool->lent_cnt;
+}
+
+/* Returns how many more pages allocations with FLAGS can get
+   before they fail: the free pages of their pool, plus those the
+   other pool would lend them. */
+size_t
+palloc_available (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	struct pool *lender = flags & PAL_USER ? &kernel_pool : &user_pool;
+	size_t cnt = pool->free_cnt;
+
+	if ((flags & PAL_USER) && user_page_limit != SIZE_MAX)
+		lender = NULL;
+	if (lender != NULL && lender->free_cnt > lender->high_water)
+		cnt += lender->free_cnt - lender->high_water;
+	return cnt;
+}
+
+/* Returns true if PAGE was lent by its pool to an allocation made
+   for the other pool. */
+bool
+palloc_is_lent (void *page) {
+	struct pool *pool;
+
+	if (page_from_pool (&kernel_pool, page))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, page))
+		pool = &user_pool;
+	else
+		return false;
+	return bitmap_test (pool->lent_map, pg_no (page) - pg_no (pool->base));
+}
+
+/* Prints the occupancy of both pools. */
+void
+palloc_print_stats (void) {
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+	const char *names[] = { "kernel", "user" };
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		struct pool *p = pools[i];
+		size_t size = bitmap_size (p->used_map);
+		printf ("Palloc: %s pool %zu/%zu pages used, %zu lent out "
+				"(watermarks %zu/%zu)\n", names[i], size - p->free_cnt, size,
+				p->lent_cnt, p->low_water, p->high_water);
+		printf ("Palloc: %s pool fragmentation index %d for 8-page runs, "
+				"%zu compactions migrated %zu frames\n", names[i],
+				palloc_frag_index (i == 0 ? 0 : PAL_USER, 8),
+				p->compact_cnt, p->migrate_cnt);
+	}
+}
+
+/* Returns the fragmentation index of the pool selected by FLAGS
+   for runs of PAGE_CNT pages, in thousandths, as Linux defines it:
+   -1000 if such a run is free now, otherwise a value towards 0 if
+   a failure would be due to lack of memory and towards 1000 if it
+   would be due to fragmentation. */
+int
+palloc_frag_index (enum palloc_flags flags, size_t page_cnt) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t size = bitmap_size (pool->used_map);
+	size_t free_pages = 0, free_runs = 0;
+	size_t i = 0;
+
+	ASSERT (page_cnt > 0);
+	lock_acquire (&pool->lock);
+	while ((i = bitmap_scan (pool->used_map, i, 1, false)) != BITMAP_ERROR) {
+		size_t end = bitmap_scan (pool->used_map, i, 1, true);
+		if (end == BITMAP_ERROR)
+			end = size;
+		if (end - i >= page_cnt) {
+			lock_release (&pool->lock);
+			return -1000;
+		}
+		free_pages += end - i;
+		free_runs++;
+		i = end;
+	}
+	lock_release (&pool->lock);
+
+	if (free_runs == 0)
+		return 0;
+	return 1000 - (int) ((1000 + free_pages * 1000 / page_cnt) / free_runs);
+}
+
+/* Fills in U for the pool selected by FLAGS.  Takes no lock, so
+   that it can be used with interrupts off, e.g. from an interrupt
+   handler; the result may be slightly off if the pool is in use. */
+void
+palloc_get_usage (enum palloc_flags flags, struct palloc_usage *u) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t size = bitmap_size (pool->used_map);
+	size_t i = 0;
+
+	memset (u, 0, sizeof *u);
+	u->total = size;
+	u->used = size - bitmap_count (pool->used_map, 0, size, false);
+	u->lent = bitmap_count (pool->lent_map, 0, size, true);
+	while ((i = bitmap_scan (pool->used_map, i, 1, false)) != BITMAP_ERROR) {
+		size_t end = bitmap_scan (pool->used_map, i, 1, true);
+		size_t len, bucket = 0;
+
+		if (end == BITMAP_ERROR)
+			end = size;
+		for (len = end - i; len > 1 && bucket < PALLOC_RUN_BUCKETS - 1;
+				len >>= 1)
+			bucket++;
+		u->runs[bucket]++;
+		i = end;
+	}
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR.  If LEND is true the pages
+   are for the other pool, which is only allowed while POOL stays
+   above its high watermark. */
+static size_t
+take_pages (struct pool *pool, size_t page_cnt, bool lend) {
+	size_t page_idx;
+
+	lock_acquire (&pool->lock);
+	if (lend && pool->free_cnt < page_cnt + pool->high_water)
+		page_idx = BITMAP_ERROR;
+	else
+		page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	if (page_idx != BITMAP_ERROR) {
+		enum intr_level old_level = intr_disable ();
+		pool->free_cnt -= page_cnt;
+		if (lend) {
+			bitmap_set_multiple (pool->lent_map, page_idx, page_cnt, true);
+			pool->lent_cnt += page_cnt;
+		}
+		intr_set_level (old_level);
+	}
+	lock_release (&pool->lock);
+	return page_idx;
+}
+
+#ifdef VM
+/* Tries to make room for PAGE_CNT contiguous pages in POOL by
+   migrating the user frames in the way to free pages elsewhere in
+   POOL.  Picks the window with the fewest used pages, all of which
+   must be movable.  Returns the index of the window, which is then
+   allocated to the caller, or BITMAP_ERROR. */
+static size_t
+compact_pool (struct pool *pool, size_t page_cnt) {
+	size_t size = bitmap_size (pool->used_map);
+	size_t best = BITMAP_ERROR, best_used = SIZE_MAX;
+	size_t used = 0, pin_end = 0;
+	enum intr_level old_level;
+	size_t i;
+
+	lock_acquire (&pool->lock);
+	old_level = intr_disable ();
+	if (pool->free_cnt < page_cnt)
+		goto done;
+	bitmap_set_all (pool->movable_map, false);
+	vm_for_each_movable_frame (mark_movable, pool);
+
+	/* Slide a window of PAGE_CNT pages over the pool.  A window
+	   qualifies if it starts at or after PIN_END, the index just
+	   past the last page that cannot be moved. */
+	for (i = 0; i < size; i++) {
+		if (bitmap_test (pool->used_map, i)) {
+			used++;
+			if (!bitmap_test (pool->movable_map, i))
+				pin_end = i + 1;
+		}
+		if (i >= page_cnt && bitmap_test (pool->used_map, i - page_cnt))
+			used--;
+		if (i + 1 >= page_cnt && i + 1 - page_cnt >= pin_end
+				&& used < best_used) {
+			best = i + 1 - page_cnt;
+			best_used = used;
+		}
+	}
+	if (best == BITMAP_ERROR)
+		goto done;
+
+	/* Claim the window page by page.  Frames are moved to the
+	   lowest free page outside of it, which keeps them packed
+	   towards the bottom of the pool. */
+	for (i = best; i < best + page_cnt; i++) {
+		void *page = pool->base + PGSIZE * i;
+		size_t dst;
+
+		if (!bitmap_test (pool->used_map, i)) {
+			bitmap_mark (pool->used_map, i);
+			continue;
+		}
+
+		dst = bitmap_scan (pool->used_map, 0, 1, false);
+		if (dst >= best && dst < best + page_cnt)
+			dst = bitmap_scan (pool->used_map, best + page_cnt, 1, false);
+		ASSERT (dst != BITMAP_ERROR);
+		bitmap_mark (pool->used_map, dst);
+		if (bitmap_test (pool->lent_map, i)) {
+			bitmap_reset (pool->lent_map, i);
+			bitmap_mark (pool->lent_map, dst);
+		}
+		vm_migrate_frame (page, pool->base + PGSIZE * dst);
+#ifdef HEAPPROF
+		heapprof_free (page);
+#endif
+		pool->migrate_cnt++;
+	}
+	pool->free_cnt -= page_cnt;
+	pool->compact_cnt++;
+
+done:
+	intr_set_level (old_level);
+	lock_release (&pool->lock);
+	return best;
+}
+
+/* Marks PAGE movable in POOL_, if it belongs to it. */
+static void
+mark_movable (void *page, void *pool_) {
+	struct pool *pool = pool_;
+
+	if (page_from_pool (pool, page))
+		bitmap_mark (pool->movable_map, pg_no (page) - pg_no (pool->base));
+}
+#endif
+
+/* Counts POOL's free pages, once populate_pools() is done with
+   it, and derives its watermarks from its size. */
+static void
+set_watermarks (struct pool *pool) {
+	size_t size = bitmap_size (pool->used_map);
+
+	pool->free_cnt = bitmap_count (pool->used_map, 0, size, false);
+	pool->lent_cnt = 0;
+	pool->low_water = size / 16;
+	pool->high_water = size / 8;
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -335,10 +733,14 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
      Calculate the space needed for the bitmap
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t bm_size = bitmap_buf_size (pgcnt);
+	size_t bm_pages = DIV_ROUND_UP (3 * bm_size, PGSIZE) * PGSIZE;
 
 	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_size);
+	p->lent_map = bitmap_create_in_buf (pgcnt, *bm_base + bm_size, bm_size);
+	p->movable_map = bitmap_create_in_buf (pgcnt, *bm_base + 2 * bm_size,
+			bm_size);
 	p->base = (void *) start;
 
 	// Mark all to unusable.
@@ -0,0 +1,68 @@
+#include "threads/shrinker.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+
+/* Registered shrinkers, most recently registered first.  Caches
+   built on top of malloc() register after it, so they are asked
+   first and the blocks they free can still be returned as whole
+   arenas by malloc's own shrinker. */
+static struct shrinker *shrinkers;
+
+/* True while some thread is running the shrinkers. */
+static bool shrinking;
+
+/* Adds S to the registry.  S must stay valid for the lifetime of
+   the kernel. */
+void
+shrinker_register (struct shrinker *s) {
+	enum intr_level old_level;
+
+	ASSERT (s != NULL && s->shrink != NULL);
+
+	old_level = intr_disable ();
+	s->calls = s->freed = 0;
+	s->next = shrinkers;
+	shrinkers = s;
+	intr_set_level (old_level);
+}
+
+/* Asks the registered shrinkers, in turn, for TARGET pages, and
+   returns how many pages they freed.  Stops as soon as the target
+   is met.  If another thread is already shrinking, returns 0 at
+   once, as that thread is freeing what there is to free. */
+size_t
+shrink_caches (size_t target) {
+	enum intr_level old_level;
+	struct shrinker *s;
+	size_t freed = 0;
+
+	old_level = intr_disable ();
+	if (shrinking) {
+		intr_set_level (old_level);
+		return 0;
+	}
+	shrinking = true;
+	intr_set_level (old_level);
+
+	for (s = shrinkers; s != NULL && freed < target; s = s->next) {
+		size_t n = s->shrink (target - freed);
+		s->calls++;
+		s->freed += n;
+		freed += n;
+	}
+
+	shrinking = false;
+	return freed;
+}
+
+/* Prints how much each shrinker has given back. */
+void
+shrinker_print_stats (void) {
+	struct shrinker *s;
+
+	for (s = shrinkers; s != NULL; s = s->next)
+		printf ("Shrinker: %s returned %zu pages in %zu calls\n",
+				s->name, s->freed, s->calls);
+}
@@ -387,6 +387,21 @@ tid_t thread_tid(void)
 	return thread_current()->tid;
 }
 
+/* Invokes function FUNC on all threads, passing along AUX.
+   This function must be called with interrupts off. */
+void thread_foreach(thread_action_func *func, void *aux)
+{
+	struct list_elem *e;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+	{
+		struct thread *t = list_entry(e, struct thread, allelem);
+		func(t, aux);
+	}
+}
+
 /* Deschedules the current thread and destroys it.  Never
    returns to the caller. */
 void thread_exit(void)
@@ -396,12 +411,11 @@ void thread_exit(void)
 #ifdef USERPROG
 	process_exit();
 #endif
-	/* 스레드 종료 시 all_list에서 제거 */
-	list_remove(&thread_current()->allelem);
-
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable();
+	/* 스레드 종료 시 all_list에서 제거 */
+	list_remove(&thread_current()->allelem);
 	do_schedule(THREAD_DYING);
 	NOT_REACHED();
 }
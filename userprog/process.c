@@ -21,6 +21,7 @@
 #include "userprog/syscall.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/rss.h"
 #endif
 #include "lib/kernel/hash.h"
 
@@ -266,6 +267,7 @@ int process_exec(void *f_name) /* 프로세스 실행 - 실행하려는 바이
 
 #ifdef VM
 	supplemental_page_table_init(&thread_current()->spt);
+	vm_exec_begin();
 #endif
 
 	/* 파싱하기 */
@@ -333,18 +335,6 @@ int process_wait(tid_t child_tid UNUSED)
 	return child_exit_status;
 }
 
-#ifdef VM
-void mmap_destroy(struct hash_elem *hash_elem, void *aux)
-{
-	struct page *page = hash_entry(hash_elem, struct page, hash_elem);
-
-	if (page && page_get_type(page) == VM_FILE)
-	{
-		munmap(page->va);
-	}
-}
-#endif
-
 /* Exit the process. This function is called by thread_exit (). */
 void process_exit(void)
 {
@@ -354,7 +344,10 @@ void process_exit(void)
  * TODO: project2/process_termination.html).
  * TODO: We recommend you to implement process resource cleanup here. */
 #ifdef VM
-	hash_apply(&curr->spt.vm, mmap_destroy);
+	/* 페이지를 정리하기 전에 상주 집합과 fault 수를 남긴다. */
+	if (curr->pml4 != NULL)
+		rss_exit();
+	do_munmap_all();
 #endif
 	for (int i = 0; i < FD_LIMIT; i++)
 	{
@@ -790,41 +783,10 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT(pg_ofs(upage) == 0);
 	ASSERT(ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0)
-	{
-		/* Do calculate how to fill this page.
-		 * We will read PAGE_READ_BYTES bytes from FILE
-		 * and zero the final PAGE_ZERO_BYTES bytes. */
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-		/* 여기서 고민한 점
-		 * 1. load_segment → vm_alloc_page_with_initializer를 통해 기대하는 결과는?
-		 * 2. upage와 kpage의 구분
-		 * 3. lazy_load_segment에 넘겨줄 aux가 뭘까
-		 * 4. lazy loading을 위해 파일 정보를 임시로 저장해둔 뒤,
-		 *    lazy_load_segment로 보내 한꺼번에 로드하고 싶다면 새로운 구조체를 만들어야할까 */
-		struct aux_for_lazy_load *aux = (struct aux_for_lazy_load *)malloc(sizeof(struct aux_for_lazy_load));
-
-		/* page fault 시에만 lazy load */
-		aux->load_file = file;
-		aux->offset = ofs;
-		aux->read_bytes = page_read_bytes;
-		aux->zero_bytes = page_zero_bytes;
-
-		/* Set up aux to pass information to the lazy_load_segment. */
-		if (!vm_alloc_page_with_initializer(VM_ANON, upage, writable, lazy_load_segment, aux))
-		{
-			free(aux);
-			return false;
-		}
-
-		/* Advance. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
-		ofs += page_read_bytes;
-	}
-	return true;
+	/* 세그먼트 전체를 영역 하나로 기록한다. 페이지와 lazy_load_segment에 넘길
+	 * aux는 page fault가 날 때 spt_get_page()가 영역에서 만든다. */
+	return vma_add(&thread_current()->spt, upage, upage + read_bytes + zero_bytes, VM_ANON,
+				   writable, file, ofs, read_bytes) != NULL;
 }
 
 /* Create a PAGE of stack at the USER_STACK. Return true on success. */
@@ -839,7 +801,9 @@ setup_stack(struct intr_frame *if_)
 	 * TODO: If success, set the rsp accordingly.
 	 * TODO: You should mark the page is stack. */
 	/* TODO: Your code goes here */
-	if (!vm_alloc_page(VM_MARKER_0 | VM_ANON, stack_bottom, true))
+	/* 스택 영역은 vm_stack_growth()가 아래로 늘린다. */
+	if (!vma_add(&thread_current()->spt, stack_bottom, (void *)USER_STACK, VM_MARKER_0 | VM_ANON,
+				 true, NULL, 0, 0))
 	{
 		return false;
 	}
@@ -849,7 +813,6 @@ setup_stack(struct intr_frame *if_)
 	if (success)
 	{
 		if_->rsp = USER_STACK;
-		thread_current()->stack_bottom = stack_bottom;
 	}
 
 	return success;
@@ -14,6 +14,7 @@
 #include "userprog/process.h"
 #include "kernel/stdio.h"
 #include "threads/palloc.h"
+#include "userprog/uaccess.h"
 #include "include/vm/vm.h"
 
 /* System call.
@@ -49,6 +50,11 @@ void syscall_init(void)
 /* The main system call interface */
 void syscall_handler(struct intr_frame *f UNUSED)
 {
+#ifdef VM
+	vm_exec_end();
+	/* 커널에서 유저 버퍼를 건드리다 난 fault도 스택을 늘릴 수 있도록 */
+	thread_current()->user_rsp = (void *)f->rsp;
+#endif
 	switch (f->R.rax) /* rax : system call number */
 	{
 	/* Projects 2 and later.
@@ -102,6 +108,9 @@ void syscall_handler(struct intr_frame *f UNUSED)
 	case SYS_MUNMAP:
 		munmap(f->R.rdi);
 		break;
+	case SYS_MADVISE:
+		f->R.rax = madvise((void *)f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
 	default:
 		exit(-1);
 		break;
@@ -110,18 +119,19 @@ void syscall_handler(struct intr_frame *f UNUSED)
 
 /* 주소 값이 유저 영역에서 사용하는 주소 값인지 확인 하는 함수
    유저 영역을 벗어난 영역일 경우 프로세스 종료(exit(-1)) */
-struct page *
+struct vma *
 check_address(void *addr)
 {
 #ifdef VM
-	struct page *page = spt_find_page(&thread_current()->spt, addr);
+	/* 아직 건드리지 않아 struct page가 없는 페이지도 영역 안이면 유효하다. */
+	struct vma *vma = vma_find(&thread_current()->spt, addr);
 
-	if (!addr || !(is_user_vaddr(addr)) || !page)
+	if (!addr || !(is_user_vaddr(addr)) || !vma)
 	{
 		exit(-1);
 	}
 
-	return page;
+	return vma;
 #else
 	if (addr = NULL || !(is_user_vaddr(addr)) || pml4_get_page(thread_current()->pml4, addr) == NULL)
 	{
@@ -130,18 +140,26 @@ check_address(void *addr)
 #endif
 }
 
-void check_valid_buffer(void *buffer, unsigned size, bool is_read)
+/* Copies the string at user address USTR into a new page, which the
+ * caller frees.  Exits the process if it may not read the string.
+ * Returns NULL if the string does not fit in a page or no page is
+ * left. */
+static char *copy_user_string(const char *ustr)
 {
-	// PJ3
-	for (char i = 0; i < size; i++)
-	{
-		struct page *page = check_address(buffer + i);
+	char *kstr = palloc_get_page(0);
+	int len;
 
-		if (is_read && !page->writable)
-		{
+	if (kstr == NULL)
+		return NULL;
+	len = strncpy_from_user(kstr, ustr, PGSIZE);
+	if (len < 0 || len == PGSIZE)
+	{
+		palloc_free_page(kstr);
+		if (len < 0)
 			exit(-1);
-		}
+		return NULL;
 	}
+	return kstr;
 }
 
 /* PintOS를 종료시킨다. */
@@ -172,16 +190,26 @@ void exit(int status)
    return value : T/F */
 bool create(const char *file, unsigned initial_size)
 {
-	check_address(file);
-	return filesys_create(file, initial_size);
+	char *name = copy_user_string(file);
+
+	if (name == NULL)
+		return false;
+	bool success = filesys_create(name, initial_size);
+	palloc_free_page(name);
+	return success;
 }
 
 /* 파일을 삭제한다.
    return value : T/F */
 bool remove(const char *file)
 {
-	check_address(file);
-	return filesys_remove(file);
+	char *name = copy_user_string(file);
+
+	if (name == NULL)
+		return false;
+	bool success = filesys_remove(name);
+	palloc_free_page(name);
+	return success;
 }
 
 /* 새롭게 프로그램을 실행시키는 시스템 콜
@@ -189,14 +217,10 @@ bool remove(const char *file)
 int exec(const char *cmd_line)
 {
 	/* 새롭게 할당받아 프로그램을 실행시킨다. */
-	check_address(cmd_line);
-	char *fn_copy = palloc_get_page(0);
+	char *fn_copy = copy_user_string(cmd_line);
 	if (fn_copy == NULL)
 		return -1;
-	memcpy(fn_copy, cmd_line, strlen(cmd_line) + 1);
 
-	char *save_ptr;
-	strtok_r(cmd_line, " ", &save_ptr);
 	if (process_exec(fn_copy) == -1)
 	{
 		exit(-1);
@@ -222,16 +246,17 @@ tid_t fork(const char *thread_name, struct intr_frame *f)
    return value : fd/-1 */
 int open(const char *file)
 {
-	check_address(file);
+	char *name = copy_user_string(file);
 
-	if (file == NULL)
+	if (name == NULL)
 	{
 		return -1;
 	}
 
 	lock_acquire(&file_lock);
-	struct file *open_file = filesys_open(file);
+	struct file *open_file = filesys_open(name);
 	lock_release(&file_lock);
+	palloc_free_page(name);
 
 	if (open_file == NULL)
 	{
@@ -265,53 +290,79 @@ int filesize(int fd)
 	return result;
 }
 
+/* 유저 버퍼는 한 페이지씩 커널 페이지를 거쳐 lock 없이 복사한다.
+ * 그래야 버퍼에서 난 page fault가 디스크를 읽는 동안 file_lock을 쥐고 있지 않는다. */
 int read(int fd, void *buffer, unsigned size)
 {
-	check_valid_buffer(buffer, size, true);
+	if (!access_ok(buffer, size, true))
+	{
+		exit(-1);
+	}
 
-	int read_result;
+	unsigned read_result = 0;
 	struct file *file_obj = process_get_file(fd);
 	if (file_obj == NULL)
 	{ /* if no file in fdt, return -1 */
 		return -1;
 	}
 
-	/* STDIN */
-	if (fd == 0)
+	/* STDOUT */
+	if (fd == 1)
 	{
-		int i;
-		char *buf = buffer;
-		for (i = 0; i < size; i++)
-		{
-			lock_acquire(&file_lock);
-			char c = input_getc();
-			lock_release(&file_lock);
-			*buf++ = c;
-			if (c == '\0')
-				break;
-		}
-		read_result = i;
+		return -1;
 	}
-	/* STDOUT */
-	else if (fd == 1)
+
+	char *kbuf = palloc_get_page(0);
+	if (kbuf == NULL)
 	{
-		read_result = -1;
+		return -1;
 	}
-	else
+	while (read_result < size)
 	{
-		lock_acquire(&file_lock);
-		read_result = file_read(file_obj, buffer, size);
-		lock_release(&file_lock);
+		unsigned chunk = size - read_result < PGSIZE ? size - read_result : PGSIZE;
+		unsigned n = 0;
+
+		/* STDIN */
+		if (fd == 0)
+		{
+			for (; n < chunk; n++)
+			{
+				lock_acquire(&file_lock);
+				kbuf[n] = input_getc();
+				lock_release(&file_lock);
+				if (kbuf[n] == '\0')
+					break;
+			}
+		}
+		else
+		{
+			lock_acquire(&file_lock);
+			n = file_read(file_obj, kbuf, chunk);
+			lock_release(&file_lock);
+		}
+
+		if (!copy_to_user(buffer + read_result, kbuf, n))
+		{
+			palloc_free_page(kbuf);
+			exit(-1);
+		}
+		read_result += n;
+		if (n < chunk)
+			break;
 	}
+	palloc_free_page(kbuf);
 
 	return read_result;
 }
 
 int write(int fd, const void *buffer, unsigned size)
 {
-	check_valid_buffer(buffer, size, false);
+	if (!access_ok(buffer, size, false))
+	{
+		exit(-1);
+	}
 
-	int write_result;
+	unsigned write_result = 0;
 	struct file *file_obj = process_get_file(fd);
 
 	if (file_obj == NULL)
@@ -319,26 +370,47 @@ int write(int fd, const void *buffer, unsigned size)
 		return -1;
 	}
 
-	/* STDOUT */
-	if (fd == 1) /* to print buffer strings on the console */
+	/* STDIN */
+	if (fd == 0) // write할 수가 없음
 	{
-		lock_acquire(&file_lock);
-		putbuf(buffer, size);
-		lock_release(&file_lock);
-		write_result = size;
+		return -1;
 	}
-	/* STDIN */
-	else if (fd == 0) // write할 수가 없음
+
+	char *kbuf = palloc_get_page(0);
+	if (kbuf == NULL)
 	{
-		write_result = -1;
+		return -1;
 	}
-	/* FILE */
-	else
+	while (write_result < size)
 	{
+		unsigned chunk = size - write_result < PGSIZE ? size - write_result : PGSIZE;
+		unsigned n;
+
+		if (!copy_from_user(kbuf, buffer + write_result, chunk))
+		{
+			palloc_free_page(kbuf);
+			exit(-1);
+		}
+
 		lock_acquire(&file_lock);
-		write_result = file_write(file_obj, buffer, size);
+		/* STDOUT */
+		if (fd == 1) /* to print buffer strings on the console */
+		{
+			putbuf(kbuf, chunk);
+			n = chunk;
+		}
+		/* FILE */
+		else
+		{
+			n = file_write(file_obj, kbuf, chunk);
+		}
 		lock_release(&file_lock);
+
+		write_result += n;
+		if (n < chunk)
+			break;
 	}
+	palloc_free_page(kbuf);
 
 	return write_result;
 }
@@ -408,11 +480,6 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
 		return NULL;
 	}
 
-	if (spt_find_page(&thread_current()->spt, addr))
-	{
-		return NULL;
-	}
-
 	struct file *file = process_get_file(fd);
 
 	if (file == NULL)
@@ -433,7 +500,20 @@ void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
 	size_t length_result = file_length(file);
 	lock_release(&file_lock);
 
-	return do_mmap(addr, length_result, writable, file, offset);
+	void *mapping = do_mmap(addr, length_result, writable & ~MAP_POPULATE, file, offset);
+
+	if (mapping == NULL)
+	{
+		lock_acquire(&file_lock);
+		file_close(file);
+		lock_release(&file_lock);
+		return NULL;
+	}
+
+	/* MAP_POPULATE: 페이지마다 fault를 내지 않도록 매핑 전체를 지금 읽어 둔다. */
+	if (writable & MAP_POPULATE)
+		vm_prefetch(mapping, length_result);
+	return mapping;
 }
 
 void munmap(void *addr)
@@ -444,4 +524,18 @@ void munmap(void *addr)
 	}
 
 	do_munmap(addr);
-}
\ No newline at end of file
+}
+
+/* Tells the kernel how the process will use the pages in [ADDR,
+ * ADDR + LENGTH), which must start on a page boundary.  Returns 0, or
+ * -1 if the range is not all mapped or ADVICE is unknown. */
+int madvise(void *addr, size_t length, int advice)
+{
+	if (!addr || is_kernel_vaddr(addr) || pg_round_down(addr) != addr || (long long)length <= 0 ||
+		is_kernel_vaddr(addr + length - 1))
+	{
+		return -1;
+	}
+
+	return vm_madvise(addr, length, advice) ? 0 : -1;
+}
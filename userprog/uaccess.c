@@ -0,0 +1,94 @@
+/* uaccess.c: Copying to and from user memory.
+ *
+ * System calls reach the buffers and strings a process hands them
+ * only through these functions.  A range is checked one area at a
+ * time (see vm/vma.c) instead of byte by byte: once the area holding
+ * an address is known, every page up to its end is valid, and the
+ * page fault handler brings those pages in as the copy touches them.
+ * Callers copy with no locks held, so a fault that has to read from
+ * disk does not hold up other processes' file system calls. */
+
+#include "userprog/uaccess.h"
+#include <stdint.h>
+#include <string.h>
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
+
+/* Returns true if the current process may read [UADDR, UADDR +
+ * SIZE), and write it too if WRITE is true.  An address just below
+ * the stack counts if a push there would have grown the stack, which
+ * is then grown to cover it. */
+bool access_ok(const void *uaddr, size_t size, bool write)
+{
+	uintptr_t va = (uintptr_t)uaddr;
+	uintptr_t end = va + size;
+
+	if (size == 0)
+		return true;
+	if (uaddr == NULL || end < va || !is_user_vaddr((void *)(end - 1)))
+		return false;
+#ifdef VM
+	uintptr_t rsp = (uintptr_t)thread_current()->user_rsp;
+
+	/* 영역 하나를 확인하면 그 끝까지의 페이지는 모두 유효하다. */
+	while (va < end)
+	{
+		struct vma *vma = vm_find_area((void *)va, rsp);
+
+		if (vma == NULL || (write && !vma->writable))
+			return false;
+		va = (uintptr_t)vma->end;
+	}
+#else
+	for (va = (uintptr_t)pg_round_down(uaddr); va < end; va += PGSIZE)
+	{
+		uint64_t *pte = pml4e_walk(thread_current()->pml4, va, false);
+
+		if (pte == NULL || !(*pte & PTE_P) || (write && !is_writable(pte)))
+			return false;
+	}
+#endif
+	return true;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns false,
+ * having copied nothing, if the process may not read all of them. */
+bool copy_from_user(void *dst, const void *usrc, size_t size)
+{
+	if (!access_ok(usrc, size, false))
+		return false;
+	memcpy(dst, usrc, size);
+	return true;
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns false,
+ * having copied nothing, if the process may not write all of them. */
+bool copy_to_user(void *udst, const void *src, size_t size)
+{
+	if (!access_ok(udst, size, true))
+		return false;
+	memcpy(udst, src, size);
+	return true;
+}
+
+/* Copies the null-terminated string at user address USRC into DST,
+ * which has room for SIZE bytes.  Returns the length of the string,
+ * or SIZE if it does not fit, in which case DST is not terminated.
+ * Returns -1 if the process may not read the string. */
+int strncpy_from_user(char *dst, const char *usrc, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		/* 끝을 모르니 한 페이지씩 확인하며 읽는다. */
+		if ((i == 0 || pg_ofs(usrc + i) == 0) && !access_ok(usrc + i, 1, false))
+			return -1;
+		dst[i] = usrc[i];
+		if (dst[i] == '\0')
+			return i;
+	}
+	return size;
+}
@@ -3,6 +3,11 @@
 #include "vm/vm.h"
 #include "devices/disk.h"
 #include "include/lib/kernel/bitmap.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "vm/zswap.h"
+#include <stdio.h>
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -21,12 +26,136 @@ static const struct page_operations anon_ops = {
 struct bitmap *swap_table;
 const size_t SECTORS_PER_PAGE = PGSIZE / DISK_SECTOR_SIZE; // sectors / page
 
+/* slot마다 그 slot을 가리키는 페이지 수.
+ * fork로 공유된 페이지들은 같은 slot을 함께 쓴다. */
+static uint16_t *swap_refs;
+
+/* swap_table, swap_refs와 swap_cursor를 보호한다. */
+static struct lock swap_lock;
+
+/* 다음 slot 탐색을 시작할 위치 (next-fit).
+ * 매번 0부터 찾지 않고 직전에 할당한 곳 다음부터 찾으므로,
+ * 연달아 내보낸 페이지들이 디스크에서도 이웃한 slot에 놓인다. */
+static size_t swap_cursor;
+
+/* Swap I/O counters, for anon_print_stats(). */
+static size_t swap_out_pages; /* 내보낸 페이지 수 */
+static size_t swap_out_cmds;  /* 그때 쓴 disk 명령 수 */
+static size_t swap_in_pages;  /* 읽어 들인 페이지 수 */
+static size_t swap_clean_drops; /* 쓰지 않고 버린 깨끗한 페이지 수 */
+
+static size_t swap_slot_alloc(size_t cnt);
+static void swap_slot_free(size_t slot);
+static void swap_write(size_t slot, struct page *pages[], size_t cnt);
+static size_t swap_cache_reclaim(void);
+
 /* Initialize the data for anonymous pages */
 void vm_anon_init(void)
 {
 	swap_disk = disk_get(1, 1);									// 이해하지 않음
 	size_t swap_size = disk_size(swap_disk) / SECTORS_PER_PAGE; // (size/page)*sector
 	swap_table = bitmap_create(swap_size);
+	swap_refs = calloc(swap_size, sizeof *swap_refs);
+	lock_init(&swap_lock);
+	zswap_init(swap_disk, swap_size);
+}
+
+/* 연속된 CNT개의 swap slot을 next-fit으로 할당해 첫 번호를 반환한다.
+ * 그런 자리가 없으면 BITMAP_ERROR. */
+static size_t swap_slot_alloc(size_t cnt)
+{
+	lock_acquire(&swap_lock);
+	size_t slot = bitmap_scan_and_flip(swap_table, swap_cursor, cnt, false);
+	if (slot == BITMAP_ERROR && swap_cursor != 0)
+		slot = bitmap_scan_and_flip(swap_table, 0, cnt, false);
+	if (slot != BITMAP_ERROR)
+	{
+		swap_cursor = (slot + cnt) % bitmap_size(swap_table);
+		for (size_t i = 0; i < cnt; i++)
+			swap_refs[slot + i] = 1;
+	}
+	lock_release(&swap_lock);
+	return slot;
+}
+
+/* SLOT의 참조를 하나 늘린다. */
+static void swap_slot_dup(size_t slot)
+{
+	lock_acquire(&swap_lock);
+	ASSERT(swap_refs[slot] > 0);
+	swap_refs[slot]++;
+	lock_release(&swap_lock);
+}
+
+/* SLOT의 참조를 하나 줄이고, 아무도 가리키지 않으면 비워 둔다. */
+static void swap_slot_free(size_t slot)
+{
+	lock_acquire(&swap_lock);
+	ASSERT(swap_refs[slot] > 0);
+	if (--swap_refs[slot] == 0)
+	{
+		bitmap_reset(swap_table, slot);
+		zswap_invalidate(slot);
+	}
+	lock_release(&swap_lock);
+}
+
+/* Makes the anonymous page DST refer to the same swap slot as SRC,
+ * if SRC has one.  Used by fork, where both pages hold the same
+ * contents. */
+void anon_share_swap_slot(struct page *dst, struct page *src)
+{
+	dst->anon.swap_index = src->anon.swap_index;
+	if (dst->anon.swap_index != -1)
+		swap_slot_dup(dst->anon.swap_index);
+}
+
+/* Lets go of the swap slot the resident anonymous PAGE still holds
+ * from its last swap-in, because its contents no longer match. */
+void anon_drop_swap_slot(struct page *page)
+{
+	if (page->anon.swap_index != -1)
+	{
+		swap_slot_free(page->anon.swap_index);
+		page->anon.swap_index = -1;
+	}
+}
+
+/* PAGES[0..CNT)를 SLOT부터 이어지는 slot들에 저장한다.
+ * zswap 풀에 압축해 넣을 수 있는 페이지는 풀에 넣고, 나머지는
+ * 이어지는 것끼리 disk 명령 하나로 쓴다.
+ * 다른 프로세스의 페이지일 수도 있으므로 커널 주소(kva)에서 읽는다. */
+static void swap_write(size_t slot, struct page *pages[], size_t cnt)
+{
+	const void *sectors[SWAP_CLUSTER_MAX * PGSIZE / DISK_SECTOR_SIZE];
+	size_t run = 0; /* 아직 쓰지 않고 모아 둔 페이지 수 */
+
+	ASSERT(cnt <= SWAP_CLUSTER_MAX);
+	for (size_t i = 0; i <= cnt; i++)
+	{
+		if (i < cnt && !zswap_store(slot + i, pages[i]->frame->kva))
+		{
+			for (size_t j = 0; j < SECTORS_PER_PAGE; j++)
+				sectors[run * SECTORS_PER_PAGE + j] = pages[i]->frame->kva + DISK_SECTOR_SIZE * j;
+			run++;
+			continue;
+		}
+		if (run > 0)
+		{
+			disk_writev(swap_disk, (slot + i - run) * SECTORS_PER_PAGE, sectors, run * SECTORS_PER_PAGE);
+			swap_out_pages += run;
+			swap_out_cmds++;
+			run = 0;
+		}
+	}
+}
+
+/* Prints swap I/O counts. */
+void anon_print_stats(void)
+{
+	printf("Swap: %zu pages out in %zu writes, %zu clean pages dropped, %zu pages in\n",
+		   swap_out_pages, swap_out_cmds, swap_clean_drops, swap_in_pages);
+	zswap_print_stats();
 }
 
 /* Initialize the file mapping */
@@ -59,56 +188,182 @@ static bool anon_swap_in(struct page *page, void *kva)
 	int page_no = anon_page->swap_index;
 
 	/* 스왑 테이블에서 해당 스왑 슬롯이 진짜 사용 중인지 체크  */
-	if (bitmap_test(swap_table, page_no) == false)
+	if (page_no == -1 || bitmap_test(swap_table, page_no) == false)
 	{
 		return false;
 	}
 
 	/* 해당 스왑 영역의 데이터를 가상 주소 공간 kva에 써 준다. */
-	for (int i = 0; i < SECTORS_PER_PAGE; ++i)
+	ASSERT(page->frame != NULL && page->frame->kva == kva);
+	anon_swap_in_cluster(&page, 1);
+
+	return true;
+}
+
+/* Reads the CNT anonymous PAGES, whose swap slots are adjacent and
+ * in ascending order, into their frames.  Pages held by the zswap
+ * pool are decompressed; each run of the rest is read with a single
+ * disk read. */
+void anon_swap_in_cluster(struct page *pages[], size_t cnt)
+{
+	void *sectors[(SWAP_RA_MAX + 1) * PGSIZE / DISK_SECTOR_SIZE];
+	size_t page_no = pages[0]->anon.swap_index;
+	size_t run = 0; /* 아직 읽지 않고 모아 둔 페이지 수 */
+
+	ASSERT(cnt <= SWAP_RA_MAX + 1);
+	for (size_t i = 0; i <= cnt; i++)
 	{
-		disk_read(swap_disk, page_no * SECTORS_PER_PAGE + i, kva + DISK_SECTOR_SIZE * i);
+		if (i < cnt)
+		{
+			ASSERT(pages[i]->anon.swap_index == (int)(page_no + i));
+			if (!zswap_load(page_no + i, pages[i]->frame->kva))
+			{
+				for (size_t j = 0; j < SECTORS_PER_PAGE; j++)
+					sectors[run * SECTORS_PER_PAGE + j] = pages[i]->frame->kva + DISK_SECTOR_SIZE * j;
+				run++;
+				continue;
+			}
+			/* 풀에 있던 사본은 다시 쫓겨날 때 새로 압축하면 되므로,
+			   slot을 놓아 풀의 자리를 비워 준다. */
+			anon_drop_swap_slot(pages[i]);
+		}
+		if (run > 0)
+		{
+			disk_readv(swap_disk, (page_no + i - run) * SECTORS_PER_PAGE, sectors, run * SECTORS_PER_PAGE);
+			swap_in_pages += run;
+			run = 0;
+		}
 	}
 
-	/* 다시 해당 스왑 슬롯을 false로 만들어준다. */
-	bitmap_set(swap_table, page_no, false);
-
-	return true;
+	/* 디스크에서 읽은 페이지의 swap slot은 그대로 둔다 (swap cache).
+	   다음에 쫓겨날 때까지 페이지가 수정되지 않으면 디스크에 쓰지 않고
+	   그냥 버릴 수 있다. 새로 설치된 PTE의 dirty 비트는 꺼져 있다. */
 }
 
 /* Swap out the page by writing contents to the swap disk. */
 static bool anon_swap_out(struct page *page)
 {
-	struct anon_page *anon_page = &page->anon;
+	return anon_swap_out_cluster(&page, 1);
+}
+
+/* Swaps out the CNT anonymous PAGES, which must all be resident and
+ * pinned.  Pages that still have a swap slot from their last swap-in
+ * and have not been written since are dropped without any I/O.  The
+ * rest go into adjacent swap slots with a single disk write.  Every
+ * page sharing a frame with one of PAGES after fork is swapped out
+ * with it and ends up in the same slot.
+ * Returns false, having swapped out nothing, if there is no run of
+ * free slots long enough.  Called with frame_lock held, which is
+ * released during the write if the frames are being evicted. */
+bool anon_swap_out_cluster(struct page *pages[], size_t cnt)
+{
+	struct page *dirty[SWAP_CLUSTER_MAX];
+	bool was_dirty[SWAP_CLUSTER_MAX];
+	size_t dirty_cnt = 0;
 
-	/* 비트맵을 처음부터 순회해 false 값을 가진 비트를 하나 찾는다.
-	   즉, 페이지를 할당받을 수 있는 swap slot을 하나 찾는다. */
-	int page_no = bitmap_scan(swap_table, 0, 1, false);
+	ASSERT(cnt <= SWAP_CLUSTER_MAX);
+
+	/* 쓰는 도중에 내용이 바뀌지 않도록 소유 프로세스의 PTE부터 지운다.
+	   이제 그 프로세스가 이 페이지에 접근하면 Page Fault가 뜬다.
+	   present 비트만 지워지므로, 그 뒤에 읽은 dirty 비트는 더 바뀌지 않는다. */
+	for (size_t i = 0; i < cnt; i++)
+	{
+		was_dirty[i] = false;
+		for (struct page *page = pages[i]; page != NULL; page = page->share_next)
+		{
+			uint64_t *pml4 = page->owner->pml4;
+
+			pml4_clear_page(pml4, page->va);
+			if (pml4_is_dirty(pml4, page->va))
+				was_dirty[i] = true;
+		}
+		if (pages[i]->anon.swap_index == -1 || was_dirty[i])
+			dirty[dirty_cnt++] = pages[i];
+	}
 
+	/* 비트맵에서 false 값을 가진 비트 dirty_cnt개가 이어진 곳을 찾는다.
+	   즉, 페이지들을 나란히 넣을 수 있는 swap slot들을 찾는다.
+	   모자라면 메모리에 있는 페이지들이 쥐고 있는 slot을 풀어 본다. */
+	size_t page_no = 0;
+	if (dirty_cnt > 0)
+	{
+		page_no = swap_slot_alloc(dirty_cnt);
+		if (page_no == BITMAP_ERROR && swap_cache_reclaim() > 0)
+			page_no = swap_slot_alloc(dirty_cnt);
+	}
 	if (page_no == BITMAP_ERROR)
 	{
+		/* 아무것도 내보내지 않은 상태로 PTE를 되돌린다.
+		   공유 중인 프레임은 계속 읽기 전용이다. */
+		for (size_t i = 0; i < cnt; i++)
+		{
+			struct frame *frame = pages[i]->frame;
+
+			for (struct page *page = frame->page; page != NULL; page = page->share_next)
+			{
+				uint64_t *pml4 = page->owner->pml4;
+
+				pml4_set_page(pml4, page->va, frame->kva, page->writable && frame->ref_cnt == 1);
+				pml4_set_dirty(pml4, page->va, was_dirty[i]);
+			}
+		}
 		return false;
 	}
 
-	/* 한 페이지를 디스크에 써 주기 위해 SECTORS_PER_PAGE개의 섹터에 저장해야 한다.
-	   이 때 디스크에 각 섹터의 크기 DISK_SECTOR_SIZE만큼 써 준다. */
-	for (int i = 0; i < SECTORS_PER_PAGE; ++i)
+	/* 수정된 페이지의 예전 slot은 이제 쓸모없으니 풀어 준다. */
+	for (size_t i = 0; i < dirty_cnt; i++)
 	{
-		disk_write(swap_disk, page_no * SECTORS_PER_PAGE + i, page->va + DISK_SECTOR_SIZE * i);
+		for (struct page *page = dirty[i]; page != NULL; page = page->share_next)
+			anon_drop_swap_slot(page);
 	}
+	swap_clean_drops += cnt - dirty_cnt;
 
-	/* swap table의 해당 페이지에 대한 swap slot의 비트를 TRUE로 바꿔주고,
-	   해당 페이지의 PTE에서 Present Bit을 0으로 바꿔준다.
-	   이제 프로세스가 이 페이지에 접근하면 Page Fault가 뜬다.  */
-	bitmap_set(swap_table, page_no, true);
-	pml4_clear_page(thread_current()->pml4, page->va);
+	/* 내보내는 중인 프레임이면 쓰는 동안 frame_lock을 놓는다.
+	   그 프레임들은 끝날 때까지 아무도 바꾸거나 해제하지 않는다. */
+	if (dirty_cnt > 0)
+	{
+		bool unlocked = vm_unlock_frames_for_io(dirty, dirty_cnt);
 
-	/* 페이지의 swap_index 값을 이 페이지가 저장된 swap slot의 번호로 써 준다. */
-	anon_page->swap_index = page_no;
+		swap_write(page_no, dirty, dirty_cnt);
+		if (unlocked)
+			vm_lock_frames();
+	}
+
+	/* 페이지의 swap_index 값을 이 페이지가 저장된 swap slot의 번호로 써 준다.
+	   같은 프레임을 공유하던 페이지들도 같은 slot을 가리킨다. */
+	for (size_t i = 0; i < dirty_cnt; i++)
+	{
+		dirty[i]->anon.swap_index = page_no + i;
+		for (struct page *page = dirty[i]->share_next; page != NULL; page = page->share_next)
+			anon_share_swap_slot(page, dirty[i]);
+	}
 
 	return true;
 }
 
+/* Frees the swap slots still held by resident anonymous pages, so
+ * that they can be reused.  Those pages will be written to a new
+ * slot when they are evicted.  Returns the number of slots freed.
+ * Called with frame_lock held. */
+static size_t swap_cache_reclaim(void)
+{
+	size_t freed = 0;
+
+	for (struct list_elem *e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e))
+	{
+		struct frame *frame = list_entry(e, struct frame, frame_elem);
+		struct page *page = frame->page;
+
+		if (page == NULL || frame->pinned || VM_TYPE(page->operations->type) != VM_ANON ||
+			page->anon.swap_index == -1)
+			continue;
+		for (; page != NULL; page = page->share_next)
+			anon_drop_swap_slot(page);
+		freed++;
+	}
+	return freed;
+}
+
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy(struct page *page)
@@ -119,5 +374,8 @@ anon_destroy(struct page *page)
 	// struct aux_for_lazy_load *aux = (struct aux_for_lazy_load *)(uninit->aux);
 
 	// free(aux);
-	// free(page->frame); /* frame 할당 해제 */
+	vm_page_release_frame(page); /* frame 할당 해제 */
+
+	/* swap에 있거나 swap cache에 남아 있던 slot도 돌려준다. */
+	anon_drop_swap_slot(page);
 }
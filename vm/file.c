@@ -5,6 +5,7 @@
 #include "include/threads/mmu.h"
 #include "threads/malloc.h"
 #include "include/userprog/syscall.h"
+#include <round.h>
 
 static bool file_backed_swap_in(struct page *page, void *kva);
 static bool file_backed_swap_out(struct page *page);
@@ -18,6 +19,8 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+size_t fault_around_pages = 16;
+
 /* The initializer of file vm */
 void vm_file_init(void)
 {
@@ -29,6 +32,7 @@ bool file_backed_initializer(struct page *page, enum vm_type type, void *kva)
 	/* Set up the handler */
 	page->operations = &file_ops;
 	struct file_page *file_page = &page->file;
+	return true;
 }
 
 /* Swap in the page by read contents from the file. */
@@ -58,7 +62,9 @@ static bool file_backed_swap_in(struct page *page, void *kva)
 	return true;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.  Called with
+ * frame_lock held, which is released during the write if the frame
+ * is being evicted. */
 static bool file_backed_swap_out(struct page *page)
 {
 	struct file_page *file_page UNUSED = &page->file;
@@ -68,17 +74,25 @@ static bool file_backed_swap_out(struct page *page)
 
 	struct aux_for_lazy_load *aux = (struct aux_for_lazy_load *)page->uninit.aux;
 
+	uint64_t *pml4 = page->owner->pml4;
+
+	/* present bit을 먼저 0으로 만들어, 쓰는 도중에 내용이 바뀌지 않게 한다.
+	   dirty 비트는 그 뒤에 읽어야 마지막 쓰기까지 반영된다. */
+	pml4_clear_page(pml4, page->va);
+	bool dirty = pml4_is_dirty(pml4, page->va);
+
 	/* 수정된 페이지(더티 비트 1)는 파일에 업데이트 해 놓는다.
-		그리고 더티 비트를 0으로 만들어둔다. */
-	if (pml4_is_dirty(thread_current()->pml4, page->va))
+		소유 프로세스가 아닐 수 있으므로 커널 주소(kva)에서 쓴다. */
+	if (dirty)
 	{
-		file_write_at(aux->load_file, page->va,
+		bool unlocked = vm_unlock_frames_for_io(&page, 1);
+
+		file_write_at(aux->load_file, page->frame->kva,
 					  aux->read_bytes, aux->offset);
-		pml4_set_dirty(thread_current()->pml4, page->va, 0);
+		if (unlocked)
+			vm_lock_frames();
 	}
-
-	/* present bit을 0으로 만든다. */
-	pml4_clear_page(thread_current()->pml4, page->va);
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
@@ -86,94 +100,84 @@ static void
 file_backed_destroy(struct page *page)
 {
 	struct file_page *file_page UNUSED = &page->file;
-	free(page->frame); /* frame 할당 해제 */
-}
-
-void *undo_mmap(void *initial_addr, void *addr)
-{
-	struct thread *curr_thread = thread_current();
-	struct supplemental_page_table *spt = &curr_thread->spt;
-	struct page *page;
-	while (initial_addr < addr)
-	{
-		page = spt_find_page(spt, addr);
-		spt_remove_page(spt, page);
-		initial_addr += PGSIZE;
-	}
-	return NULL;
+	vm_page_release_frame(page); /* frame 할당 해제 */
 }
 
 /* Do the mmap */
+/* 페이지를 하나씩 만들지 않고 매핑 전체를 영역 하나로 기록한다.
+ * 각 페이지는 처음 fault가 날 때 spt_get_page()가 만든다. */
 void *
 do_mmap(void *addr, size_t read_bytes, int writable,
 		struct file *file, off_t offset)
 {
-	struct thread *curr_thread = thread_current();
-	struct supplemental_page_table *spt = &curr_thread->spt;
-	void *initial_addr = addr;
-
-	while (read_bytes > 0)
-	{
-		/* to avoid overlap */
-		if (spt_find_page(&thread_current()->spt, addr))
-		{
-			/* 만약 overlap이 발생하면, 할당한 페이지 모두 할당 해제 */
-			undo_mmap(initial_addr, addr);
-		}
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		struct aux_for_lazy_load *aux = (struct aux_for_lazy_load *)malloc(sizeof(struct aux_for_lazy_load));
-		aux->load_file = file;
-		aux->offset = offset;
-		aux->read_bytes = page_read_bytes;
-		aux->zero_bytes = page_zero_bytes;
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	void *end = addr + ROUND_UP(read_bytes, PGSIZE);
 
-		if (!vm_alloc_page_with_initializer(VM_FILE, addr, writable, lazy_load_segment, aux))
-		{
-			free(aux);
-			undo_mmap(initial_addr, addr);
-		}
+	if (read_bytes == 0 || end < addr || !is_user_vaddr(end - 1))
+		return NULL;
 
-		read_bytes -= page_read_bytes;
-		addr += PGSIZE;
-		offset += page_read_bytes;
-	}
-	return initial_addr;
+	/* 다른 영역과 겹치면 실패한다. */
+	if (vma_add(spt, addr, end, VM_FILE, writable, file, offset, read_bytes) == NULL)
+		return NULL;
+	return addr;
 }
 
 /* Do the munmap */
+/* ADDR에서 시작하는 매핑을 해제한다. madvise()가 나눈 조각들도 같은 파일을
+ * 이어서 매핑하므로 함께 해제한다. 고친 페이지는 파일에 써 둔다. */
 void do_munmap(void *addr)
 {
-	struct thread *curr = thread_current();
-	struct page *page;
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct vma *vma = vma_find(spt, addr);
 
-	if ((page = spt_find_page(&curr->spt, addr)) == NULL)
+	if (vma == NULL || vma->start != addr || VM_TYPE(vma->type) != VM_FILE)
 	{
 		return;
 	}
 
-	struct file *file = ((struct aux_for_lazy_load *)page->uninit.aux)->load_file;
+	struct file *file = vma->file;
+	off_t offset = vma->offset;
+	struct page *page;
 
-	// SJ
-	if (!file)
+	while (vma != NULL && vma->start == addr && vma->file == file && vma->offset == offset)
 	{
-		return;
-	}
+		struct vma *next = vma_next(vma);
 
-	while (page != NULL && page_get_type(page) == VM_FILE)
-	{
-		if (pml4_is_dirty(curr->pml4, page->va))
+		/* 한 번도 건드리지 않은 페이지는 만들어지지도 않았으니 건너뛴다. */
+		while ((page = spt_next_page(spt, addr, vma->end)) != NULL)
 		{
-			lock_acquire(&file_lock);
-			struct aux_for_lazy_load *aux = page->uninit.aux;
-			file_write_at(aux->load_file, addr, aux->read_bytes, aux->offset);
-			pml4_set_dirty(curr->pml4, page->va, false);
-			lock_release(&file_lock);
+			/* 내보내는 중인 프레임이면 끝나기를 기다린 뒤,
+			   file_backed_swap_out()으로 고친 내용을 써 두고 매핑을 지운다. */
+			vm_lock_frames();
+			vm_wait_evicted(page);
+			if (page->frame != NULL)
+				swap_out(page);
+			vm_unlock_frames();
+			addr = page->va + PGSIZE;
+			spt_remove_page(spt, page);
 		}
+		offset += vma->end - vma->start;
+		addr = vma->end;
+		vma_remove(spt, vma);
+		vma = next;
+	}
+}
 
-		pml4_clear_page(&curr->pml4, addr);
-		addr += PGSIZE;
-		page = spt_find_page(&curr->spt, addr);
+/* Unmaps every mapping of the current process, for process_exit(). */
+void do_munmap_all(void)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct vma *vma = vma_first(spt);
+
+	while (vma != NULL)
+	{
+		/* do_munmap()이 VMA 뒤의 조각들까지 지울 수 있으므로 다음 영역은 주소로 다시 찾는다. */
+		void *start = vma->start;
+
+		if (VM_TYPE(vma->type) == VM_FILE)
+			do_munmap(start);
+		vma = vma_lookup(spt, start);
+		if (vma != NULL && vma->start == start)
+			vma = vma_next(vma);
 	}
-}
\ No newline at end of file
+}
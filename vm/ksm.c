@@ -0,0 +1,239 @@
+/* ksm.c: Same-page merging for anonymous memory.
+ *
+ * A kernel thread, ksmd, wakes up every KSM_INTERVAL ticks and hashes
+ * the next ksm_scan_pages frames of the frame table.  A frame whose
+ * hash did not change since its last visit is looked up in a table
+ * of such stable frames; if an identical frame is already there, the
+ * pages of the two are merged into one read-only frame, exactly as
+ * fork shares them, and vm_handle_wp() copies it again on the next
+ * write. */
+
+#include "vm/ksm.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* ksmd가 깨어나는 간격 (tick). */
+#define KSM_INTERVAL (TIMER_FREQ / 10)
+
+size_t ksm_scan_pages;
+
+/* 두 번 연속 같은 해시가 나온 프레임들. ksm_sum으로 찾는다.
+ * frame_lock으로 보호한다. */
+static struct hash ksm_table;
+
+/* 다음에 검사할 frame_table 위치. frame_lock으로 보호한다. */
+static struct list_elem *cursor;
+
+static size_t ksm_scanned; /* 검사한 프레임 수 */
+static size_t ksm_merged;  /* 합쳐서 돌려준 프레임 수 */
+
+static uint64_t ksm_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+	return hash_entry(e, struct frame, ksm_elem)->ksm_sum;
+}
+
+static bool ksm_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+{
+	return hash_entry(a, struct frame, ksm_elem)->ksm_sum <
+		   hash_entry(b, struct frame, ksm_elem)->ksm_sum;
+}
+
+static void ksm_thread(void *aux);
+
+/* Starts ksmd, if the -ksm option asked for it. */
+void ksm_init(void)
+{
+	hash_init(&ksm_table, ksm_hash, ksm_less, NULL);
+	if (ksm_scan_pages > 0)
+		thread_create("ksmd", PRI_DEFAULT, ksm_thread, NULL);
+}
+
+/* Forgets FRAME, which is about to be evicted or freed.  Called with
+ * frame_lock held. */
+void ksm_remove(struct frame *frame)
+{
+	if (cursor == &frame->frame_elem)
+		cursor = list_next(cursor);
+	if (frame->ksm_listed)
+		hash_delete(&ksm_table, &frame->ksm_elem);
+	frame->ksm_listed = false;
+	frame->ksm_hashed = false;
+}
+
+/* Maps every page of FRAME read-only, keeping the accessed bits.
+ * If one of them was written, the swap slot the pages still share
+ * from their last swap-in no longer matches and is dropped. */
+static void ksm_write_protect(struct frame *frame)
+{
+	struct page *page;
+	bool dirty = false;
+
+	for (page = frame->page; page != NULL; page = page->share_next)
+		if (pml4_is_dirty(page->owner->pml4, page->va))
+			dirty = true;
+
+	for (page = frame->page; page != NULL; page = page->share_next)
+	{
+		uint64_t *pml4 = page->owner->pml4;
+		bool accessed = pml4_is_accessed(pml4, page->va);
+
+		if (dirty)
+			anon_drop_swap_slot(page);
+		pml4_set_page(pml4, page->va, frame->kva, false);
+		pml4_set_accessed(pml4, page->va, accessed);
+	}
+}
+
+/* Maps the pages of FRAME writable again after ksm_write_protect(),
+ * if FRAME turned out not to be mergeable and is not shared. */
+static void ksm_unprotect(struct frame *frame)
+{
+	struct page *page = frame->page;
+
+	if (frame->ref_cnt != 1 || !page->writable)
+		return;
+
+	uint64_t *pml4 = page->owner->pml4;
+	bool accessed = pml4_is_accessed(pml4, page->va);
+
+	pml4_set_page(pml4, page->va, frame->kva, true);
+	pml4_set_accessed(pml4, page->va, accessed);
+}
+
+/* Moves every page mapping DUP over to KEEP, which holds the same
+ * bytes, and frees DUP.  Both are already write-protected.  Called
+ * with frame_lock held. */
+static void ksm_merge(struct frame *keep, struct frame *dup)
+{
+	struct page *page = dup->page;
+
+	while (page != NULL)
+	{
+		struct page *next = page->share_next;
+		uint64_t *pml4 = page->owner->pml4;
+		bool accessed = pml4_is_accessed(pml4, page->va);
+
+		/* 한 프레임을 공유하는 페이지들은 swap slot도 같아야 한다. */
+		anon_drop_swap_slot(page);
+		anon_share_swap_slot(page, keep->page);
+		pml4_set_page(pml4, page->va, keep->kva, false);
+		pml4_set_accessed(pml4, page->va, accessed);
+
+		page->frame = keep;
+		page->share_next = keep->page;
+		keep->page = page;
+		keep->ref_cnt++;
+		page = next;
+	}
+	ksm_merged++;
+
+	dup->page = NULL;
+	dup->ref_cnt = 0;
+	vm_free_frame(dup);
+}
+
+/* Hashes FRAME and merges it with an identical stable frame, if
+ * there is one.  Called with frame_lock held. */
+static void ksm_scan_frame(struct frame *frame)
+{
+	struct page *page = frame->page;
+	struct hash_elem *e;
+	struct frame *keep;
+
+	/* 실행 파일 페이지는 이미 파일 위치로 공유하고 있고, 쓰기 가능해지면 안 된다. */
+	if (page == NULL || frame->pinned || VM_TYPE(page->operations->type) != VM_ANON ||
+		frame->text_inode != NULL)
+		return;
+
+	/* palloc의 compaction이 읽는 도중에 프레임을 옮기지 않도록 pin한다. */
+	frame->pinned = true;
+	uint64_t sum = hash_bytes(frame->kva, PGSIZE);
+	frame->pinned = false;
+	ksm_scanned++;
+
+	/* 지난번과 해시가 다르면 아직 자주 바뀌는 페이지다. 다음 차례까지 기다린다. */
+	if (!frame->ksm_hashed || frame->ksm_sum != sum)
+	{
+		if (frame->ksm_listed)
+			hash_delete(&ksm_table, &frame->ksm_elem);
+		frame->ksm_listed = false;
+		frame->ksm_sum = sum;
+		frame->ksm_hashed = true;
+		return;
+	}
+	if (frame->ksm_listed)
+		return;
+
+	e = hash_insert(&ksm_table, &frame->ksm_elem);
+	if (e == NULL)
+	{
+		frame->ksm_listed = true;
+		return;
+	}
+
+	keep = hash_entry(e, struct frame, ksm_elem);
+	if (keep->pinned)
+		return;
+
+	/* 비교하는 동안 주인이 쓰면 그 내용이 사라지거나 다른 프로세스로 새므로
+	 * 먼저 둘 다 읽기 전용으로 바꾼다. 그 뒤의 쓰기는 frame_lock을 기다린다. */
+	keep->pinned = true;
+	frame->pinned = true;
+	ksm_write_protect(keep);
+	ksm_write_protect(frame);
+	bool same = memcmp(keep->kva, frame->kva, PGSIZE) == 0;
+	keep->pinned = false;
+	frame->pinned = false;
+	if (!same)
+	{
+		/* 해시만 같았거나, KEEP이 그 뒤에 쓰기 가능으로 바뀌어 수정되었다. */
+		ksm_unprotect(keep);
+		ksm_unprotect(frame);
+		hash_replace(&ksm_table, &frame->ksm_elem);
+		keep->ksm_listed = false;
+		frame->ksm_listed = true;
+		return;
+	}
+	ksm_merge(keep, frame);
+}
+
+/* ksmd: scans ksm_scan_pages frames every KSM_INTERVAL ticks,
+ * taking frame_lock for one frame at a time. */
+static void ksm_thread(void *aux UNUSED)
+{
+	for (;;)
+	{
+		timer_sleep(KSM_INTERVAL);
+		for (size_t i = 0; i < ksm_scan_pages; i++)
+		{
+			vm_lock_frames();
+			if (list_empty(&frame_table))
+			{
+				vm_unlock_frames();
+				break;
+			}
+			if (cursor == NULL || cursor == list_end(&frame_table))
+				cursor = list_begin(&frame_table);
+
+			struct frame *frame = list_entry(cursor, struct frame, frame_elem);
+			cursor = list_next(cursor);
+			ksm_scan_frame(frame);
+			vm_unlock_frames();
+		}
+	}
+}
+
+/* Prints how many frames ksmd looked at and how many it saved. */
+void ksm_print_stats(void)
+{
+	if (ksm_scan_pages > 0)
+		printf("KSM: %zu frames scanned, %zu frames saved by merging\n",
+			   ksm_scanned, ksm_merged);
+}
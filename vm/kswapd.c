@@ -0,0 +1,106 @@
+/* kswapd.c: Background page reclaim.
+ *
+ * Without it, vm_get_frame() evicts a cluster of frames only when
+ * palloc has no user page left, so the faulting process waits for
+ * the victims to be chosen and written to swap or to their files.
+ * kswapd is a kernel thread that vm_get_frame() wakes as soon as the
+ * user pages left fall below kswapd_low_pages, or the kernel pool
+ * wants back the pages it lent.  It then evicts clusters, doing the
+ * writes itself, until twice as many pages are free, while the
+ * processes keep running.  vm_get_frame() only evicts on its own
+ * ("direct reclaim") when kswapd has fallen behind.  kswapd lets go
+ * of frame_lock while it writes a cluster, so a process that needs a
+ * new frame in the meantime only waits for the write if it faults on
+ * one of the pages being written. */
+
+#include "vm/kswapd.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "vm/anon.h"
+#include "vm/vm.h"
+
+/* -kswapd를 주지 않았다는 표시. 사용자 pool의 1/32, 적어도 두 cluster로 정한다. */
+#define KSWAPD_LOW_DEFAULT SIZE_MAX
+
+size_t kswapd_low_pages = KSWAPD_LOW_DEFAULT;
+
+/* 이만큼 남을 때까지 내보낸다. */
+static size_t kswapd_high_pages;
+
+static struct semaphore kswapd_sema;
+static bool kswapd_awake; /* 깨웠는데 아직 일을 마치지 않음 */
+
+static void kswapd_thread(void *aux);
+
+/* Returns true if kswapd has work to do. */
+static bool kswapd_below(size_t pages)
+{
+	return palloc_available(PAL_USER) < pages || palloc_reclaim_wanted(0) > 0;
+}
+
+/* Sets the watermarks and starts kswapd, unless -kswapd=0. */
+void kswapd_init(void)
+{
+	if (kswapd_low_pages == KSWAPD_LOW_DEFAULT)
+	{
+		struct palloc_usage u;
+
+		palloc_get_usage(PAL_USER, &u);
+		kswapd_low_pages = u.total / 32 > 2 * SWAP_CLUSTER_MAX ? u.total / 32 : 2 * SWAP_CLUSTER_MAX;
+	}
+	kswapd_high_pages = 2 * kswapd_low_pages;
+	sema_init(&kswapd_sema, 0);
+	if (kswapd_enabled())
+		thread_create("kswapd", PRI_DEFAULT, kswapd_thread, NULL);
+}
+
+bool kswapd_enabled(void)
+{
+	return kswapd_low_pages > 0;
+}
+
+/* Wakes kswapd if memory is getting short.  Called by vm_get_frame()
+ * after every allocation. */
+void kswapd_check(void)
+{
+	enum intr_level old_level;
+
+	if (!kswapd_enabled() || kswapd_awake || !kswapd_below(kswapd_low_pages))
+		return;
+
+	old_level = intr_disable();
+	if (!kswapd_awake)
+	{
+		kswapd_awake = true;
+		sema_up(&kswapd_sema);
+	}
+	intr_set_level(old_level);
+}
+
+/* kswapd: evicts one cluster at a time, taking frame_lock for each,
+ * until the high watermark is reached or nothing more can go.  Gives
+ * up after evicting as many frames as the high watermark, so that it
+ * does not spin when the pages it frees go to the other pool. */
+static void kswapd_thread(void *aux UNUSED)
+{
+	for (;;)
+	{
+		size_t budget = kswapd_high_pages;
+
+		sema_down(&kswapd_sema);
+		vm_stats.kswapd_wakeups++;
+		while (budget > 0 && kswapd_below(kswapd_high_pages))
+		{
+			size_t cnt = vm_reclaim();
+
+			if (cnt == 0)
+				break;
+			vm_stats.kswapd_pages += cnt;
+			budget = cnt < budget ? budget - cnt : 0;
+		}
+		kswapd_awake = false;
+	}
+}
@@ -0,0 +1,254 @@
+/* replace.c: Page replacement policies. */
+
+#include "vm/replace.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "threads/mmu.h"
+#include "vm/rss.h"
+#include "vm/vm.h"
+
+/* 프레임의 accessed 비트를 소유 프로세스의 페이지 테이블에서 확인하고 지운다.
+ * fork 뒤에 공유 중인 프레임은 매핑한 프로세스 중 하나라도 썼으면 참조된 것이다. */
+static bool frame_referenced(struct frame *frame)
+{
+	bool referenced = false;
+
+	for (struct page *page = frame->page; page != NULL; page = page->share_next)
+	{
+		uint64_t *pml4 = page->owner->pml4;
+
+		/* young이면 working set 표본을 뜨면서 지운 accessed 비트다 (vm/rss.c). */
+		if (!pml4_is_accessed(pml4, page->va) && !page->young)
+			continue;
+		pml4_set_accessed(pml4, page->va, 0);
+		page->young = false;
+		vm_readahead_settle(page, true);
+		rss_note_access(page);
+		referenced = true;
+	}
+	return referenced;
+}
+
+/* --- clock ---------------------------------------------------------------
+ * 단일 hand second-chance. frame_table 전체를 돌며 accessed 비트가 꺼진
+ * 첫 프레임을 내보낸다. 한 번만 쓰고 마는 페이지도 새로 들어올 때
+ * accessed 비트가 켜져 있으므로, 큰 순차 scan이 hot 페이지를 모두 밀어낸다. */
+
+static struct list_elem *hand;
+
+static void clock_init(void)
+{
+	hand = list_begin(&frame_table);
+}
+
+static void clock_insert(struct frame *frame UNUSED)
+{
+	/* frame_table에 이미 들어 있다. */
+}
+
+static void clock_remove(struct frame *frame)
+{
+	if (hand == &frame->frame_elem)
+		hand = list_next(hand);
+}
+
+static void clock_deactivate(struct frame *frame UNUSED)
+{
+	/* accessed 비트가 꺼져 있으니 hand가 지나갈 때 바로 내보낸다. */
+}
+
+static struct frame *clock_victim(void)
+{
+	size_t frame_cnt = list_size(&frame_table);
+
+	/* 한 바퀴는 accessed 비트만 지우고 지나갈 수 있으니 두 바퀴까지 돈다. */
+	for (size_t i = 0; i < 2 * frame_cnt; i++)
+	{
+		if (hand == list_end(&frame_table))
+			hand = list_begin(&frame_table);
+
+		struct frame *frame = list_entry(hand, struct frame, frame_elem);
+		hand = list_next(hand);
+
+		if (frame->pinned || frame->page == NULL)
+			continue;
+		if (!frame_referenced(frame))
+			return frame;
+	}
+
+	return NULL;
+}
+
+static const struct replace_policy clock_policy = {
+	.name = "clock",
+	.init = clock_init,
+	.insert = clock_insert,
+	.remove = clock_remove,
+	.deactivate = clock_deactivate,
+	.victim = clock_victim,
+};
+
+/* --- 2q ------------------------------------------------------------------
+ * Johnson & Shasha의 2Q를 accessed 비트로 근사한다.
+ * 새로 들어온 페이지는 inactive 리스트(A1in)에서 시작하고, 그곳에 있는
+ * 동안 다시 참조되어야 active 리스트(Am)로 올라간다. 한 번만 쓰인 scan
+ * 페이지는 inactive에서 바로 내보내지므로 active의 hot 페이지가 남는다.
+ * ghost 리스트(A1out)는 따로 두지 않고, 페이지가 쫓겨날 때의 eviction
+ * 번호(page->evict_seq)로 "최근에 쫓겨났는지"를 판단한다. */
+
+static struct list inactive_list;
+static struct list active_list;
+static size_t inactive_cnt;
+static size_t active_cnt;
+
+static void twoq_init(void)
+{
+	list_init(&inactive_list);
+	list_init(&active_list);
+}
+
+static void twoq_move(struct frame *frame, int to)
+{
+	if (frame->lru == FRAME_INACTIVE)
+		inactive_cnt--;
+	else if (frame->lru == FRAME_ACTIVE)
+		active_cnt--;
+	if (frame->lru != FRAME_UNLISTED)
+		list_remove(&frame->lru_elem);
+
+	frame->lru = to;
+	if (to == FRAME_INACTIVE)
+	{
+		list_push_back(&inactive_list, &frame->lru_elem);
+		inactive_cnt++;
+	}
+	else if (to == FRAME_ACTIVE)
+	{
+		list_push_back(&active_list, &frame->lru_elem);
+		active_cnt++;
+	}
+}
+
+static void twoq_insert(struct frame *frame)
+{
+	struct page *page = frame->page;
+	size_t ghost_cnt = (active_cnt + inactive_cnt) / 2 + 1;
+
+	/* 최근 ghost_cnt번의 eviction 안에 쫓겨났던 페이지는 A1out에 있던
+	 * 것으로 보고 바로 active로 넣는다. */
+	if (page->evict_seq != 0 && vm_stats.evictions - page->evict_seq < ghost_cnt)
+		twoq_move(frame, FRAME_ACTIVE);
+	else
+		twoq_move(frame, FRAME_INACTIVE);
+}
+
+static void twoq_remove(struct frame *frame)
+{
+	twoq_move(frame, FRAME_UNLISTED);
+}
+
+/* 다음 victim으로 inactive 리스트의 맨 앞에 둔다. */
+static void twoq_deactivate(struct frame *frame)
+{
+	twoq_move(frame, FRAME_INACTIVE);
+	list_remove(&frame->lru_elem);
+	list_push_front(&inactive_list, &frame->lru_elem);
+}
+
+/* active 리스트가 TARGET개 이하가 될 때까지, 앞에서부터 최근에 참조되지
+ * 않은 프레임을 inactive 리스트 끝으로 내린다. */
+static void twoq_shrink_active(size_t target)
+{
+	for (size_t n = active_cnt; n > 0 && active_cnt > target; n--)
+	{
+		struct frame *frame = list_entry(list_front(&active_list), struct frame, lru_elem);
+
+		if (frame->pinned || frame_referenced(frame))
+			twoq_move(frame, FRAME_ACTIVE);
+		else
+			twoq_move(frame, FRAME_INACTIVE);
+	}
+}
+
+static struct frame *twoq_victim(void)
+{
+	/* 첫 바퀴는 active를 3/4로 유지하고, 그래도 내보낼 것이 없으면
+	 * active를 모두 비워 가며 다시 찾는다. */
+	for (int round = 0; round < 3; round++)
+	{
+		twoq_shrink_active(round == 0 ? (active_cnt + inactive_cnt) * 3 / 4 : 0);
+
+		for (size_t n = inactive_cnt; n > 0; n--)
+		{
+			struct frame *frame = list_entry(list_front(&inactive_list), struct frame, lru_elem);
+
+			if (frame->pinned)
+				twoq_move(frame, FRAME_INACTIVE);
+			else if (frame_referenced(frame))
+				twoq_move(frame, FRAME_ACTIVE);
+			else
+				return frame;
+		}
+	}
+
+	return NULL;
+}
+
+static const struct replace_policy twoq_policy = {
+	.name = "2q",
+	.init = twoq_init,
+	.insert = twoq_insert,
+	.remove = twoq_remove,
+	.deactivate = twoq_deactivate,
+	.victim = twoq_victim,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static const struct replace_policy *policies[] = {&clock_policy, &twoq_policy};
+static const struct replace_policy *policy = &clock_policy;
+
+/* Selects the policy called NAME.  Returns false if there is none. */
+bool replace_select(const char *name)
+{
+	for (size_t i = 0; i < sizeof policies / sizeof *policies; i++)
+	{
+		if (!strcmp(policies[i]->name, name))
+		{
+			policy = policies[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *replace_name(void)
+{
+	return policy->name;
+}
+
+void replace_init(void)
+{
+	policy->init();
+}
+
+void replace_insert(struct frame *frame)
+{
+	policy->insert(frame);
+}
+
+void replace_remove(struct frame *frame)
+{
+	policy->remove(frame);
+}
+
+void replace_deactivate(struct frame *frame)
+{
+	policy->deactivate(frame);
+}
+
+struct frame *replace_victim(void)
+{
+	return policy->victim();
+}
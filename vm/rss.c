@@ -0,0 +1,158 @@
+/* rss.c: Resident sets and working sets of processes.
+ *
+ * vm.c counts the pages each process has in frames (its resident
+ * set size, RSS) as frames are linked to and taken from its pages.
+ * With -rss-limit, a process that holds that many frames evicts one
+ * of its own pages for each new one it faults in, instead of pushing
+ * other processes' pages out to swap.
+ *
+ * A kernel thread, wsd, wakes up every ws_interval ticks, collects
+ * and clears the accessed bit of every resident page, and takes the
+ * number of pages each process used in the last interval as its
+ * working set.  So that clearing the bits does not make hot pages
+ * look cold to the replacement policy, a page whose bit wsd cleared
+ * is marked young, which frame_referenced() reads as a reference.
+ *
+ * What each process used is kept when it exits and printed with the
+ * rest of the VM statistics at power off. */
+
+#include "vm/rss.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* 끝난 프로세스 기록을 이만큼만 남긴다. */
+#define RSS_RECORDS 32
+
+size_t rss_limit_pages;
+int64_t ws_interval = TIMER_FREQ;
+
+/* 지금 표본 구간의 번호. page->ws_epoch와 같으면 이번 구간에 이미 센 페이지다.
+ * frame_lock으로 보호한다. */
+static size_t ws_epoch = 1;
+
+/* 끝난 프로세스 하나의 기록. */
+struct rss_record
+{
+	char name[16];
+	tid_t tid;
+	size_t rss, rss_peak;
+	size_t ws, ws_peak;
+	size_t major_faults, minor_faults;
+	size_t reclaims;
+};
+
+static struct rss_record records[RSS_RECORDS];
+static size_t record_cnt; /* 지금까지 끝난 프로세스 수 */
+
+static void wsd_thread(void *aux);
+
+/* Starts wsd, unless -ws-interval=0. */
+void rss_init(void)
+{
+	if (ws_interval > 0)
+		thread_create("wsd", PRI_DEFAULT, wsd_thread, NULL);
+}
+
+/* Counts PAGE in its owner's working set for this interval, once.
+ * Called with frame_lock held by whoever cleared PAGE's accessed bit. */
+void rss_note_access(struct page *page)
+{
+	if (page->ws_epoch == ws_epoch)
+		return;
+	page->ws_epoch = ws_epoch;
+	page->owner->spt.ws_tally++;
+}
+
+/* Ends the interval of process T: what it used becomes its working
+ * set estimate. */
+static void ws_roll(struct thread *t, void *aux UNUSED)
+{
+	struct supplemental_page_table *spt = &t->spt;
+
+	if (t->pml4 == NULL)
+		return;
+	spt->ws_pages = spt->ws_tally;
+	if (spt->ws_pages > spt->ws_peak)
+		spt->ws_peak = spt->ws_pages;
+	spt->ws_samples++;
+	spt->ws_tally = 0;
+}
+
+static void wsd_thread(void *aux UNUSED)
+{
+	for (;;)
+	{
+		timer_sleep(ws_interval);
+
+		vm_lock_frames();
+		for (struct list_elem *e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e))
+		{
+			struct frame *frame = list_entry(e, struct frame, frame_elem);
+
+			for (struct page *page = frame->page; page != NULL; page = page->share_next)
+			{
+				uint64_t *pml4 = page->owner->pml4;
+
+				if (pml4 == NULL || !pml4_is_accessed(pml4, page->va))
+					continue;
+				pml4_set_accessed(pml4, page->va, false);
+				page->young = true;
+				vm_readahead_settle(page, true);
+				rss_note_access(page);
+			}
+		}
+		enum intr_level old_level = intr_disable();
+		thread_foreach(ws_roll, NULL);
+		intr_set_level(old_level);
+		ws_epoch++;
+		vm_unlock_frames();
+	}
+}
+
+/* Records the resident set, working set and fault counts of the
+ * current process, which is exiting and still has all its pages. */
+void rss_exit(void)
+{
+	struct thread *curr = thread_current();
+	struct supplemental_page_table *spt = &curr->spt;
+	struct rss_record *r = &records[record_cnt % RSS_RECORDS];
+
+	vm_lock_frames();
+	strlcpy(r->name, curr->name, sizeof r->name);
+	r->tid = curr->tid;
+	r->rss = spt->rss;
+	r->rss_peak = spt->rss_peak;
+	/* 한 구간도 끝나지 않았으면 지금까지 쓴 페이지로 어림한다. */
+	r->ws = spt->ws_samples > 0 ? spt->ws_pages : spt->ws_tally;
+	r->ws_peak = spt->ws_tally > spt->ws_peak ? spt->ws_tally : spt->ws_peak;
+	r->major_faults = spt->major_faults;
+	r->minor_faults = spt->minor_faults;
+	r->reclaims = spt->rss_reclaims;
+	record_cnt++;
+	vm_unlock_frames();
+}
+
+/* Prints what each of the last processes to exit used. */
+void rss_print_stats(void)
+{
+	size_t first = record_cnt > RSS_RECORDS ? record_cnt - RSS_RECORDS : 0;
+
+	if (first > 0)
+		printf("RSS: %zu earlier processes not shown\n", first);
+	for (size_t i = first; i < record_cnt; i++)
+	{
+		struct rss_record *r = &records[i % RSS_RECORDS];
+
+		printf("Process %s (%d): RSS %zu pages (peak %zu), working set %zu pages (peak %zu), "
+			   "%zu major faults, %zu minor faults, %zu pages reclaimed\n",
+			   r->name, r->tid, r->rss, r->rss_peak, r->ws, r->ws_peak, r->major_faults,
+			   r->minor_faults, r->reclaims);
+	}
+}
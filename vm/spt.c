@@ -0,0 +1,134 @@
+/* spt.c: Supplemental page table.
+ *
+ * The struct pages of a process are kept in a 4-level radix tree
+ * indexed by virtual page number the way x86-64 indexes its page
+ * tables: the top table by PML4(va), the next by PDPE(va), then by
+ * PDX(va), and the last one holds the struct page pointers, indexed
+ * by PTX(va).  Finding a page is four array reads however many pages
+ * there are, adding pages never rehashes the ones already there, and
+ * a range of addresses is walked in order, skipping the tables that
+ * are not there.
+ *
+ * Each table is one zeroed page from the kernel pool, made the first
+ * time a page under it is added.  Like the page tables of a pml4, it
+ * is freed only with the whole tree, by spt_destroy_pages(). */
+
+#include <debug.h>
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "vm/vm.h"
+
+#define SPT_LEVELS 4	/* 표의 단계 수 */
+#define SPT_ENTRIES 512 /* 표 하나의 항목 수 */
+
+/* LEVEL 단계 표의 항목 하나가 맡는 주소 범위의 log2 (0단계가 최상위) */
+#define SPT_SHIFT(LEVEL) (PML4SHIFT - 9 * (LEVEL))
+
+/* Returns the index of VA in a table at LEVEL. */
+static size_t spt_index(const void *va, int level)
+{
+	return ((uintptr_t)va >> SPT_SHIFT(level)) & (SPT_ENTRIES - 1);
+}
+
+/* Returns the slot for the page at VA in SPT's tree.  Makes the
+ * missing tables on the way if CREATE is true; otherwise returns
+ * NULL when one is missing.  Also returns NULL if memory runs out. */
+static struct page **spt_walk(struct supplemental_page_table *spt, const void *va, bool create)
+{
+	void **slot = &spt->pages;
+
+	for (int level = 0; level < SPT_LEVELS; level++)
+	{
+		if (*slot == NULL && (!create || (*slot = palloc_get_page(PAL_ZERO)) == NULL))
+			return NULL;
+		slot = (void **)*slot + spt_index(va, level);
+	}
+	return (struct page **)slot;
+}
+
+/* Find VA from spt and return page. On error, return NULL. */
+struct page *
+spt_find_page(struct supplemental_page_table *spt, void *va)
+{
+	struct page **slot = spt_walk(spt, va, false);
+
+	return slot != NULL ? *slot : NULL; /* 사용자가 엉뚱한 va 요청했을 때 */
+}
+
+/* Insert PAGE into spt with validation. */
+bool spt_insert_page(struct supplemental_page_table *spt, struct page *page)
+{
+	struct page **slot = spt_walk(spt, page->va, true);
+
+	if (slot == NULL || *slot != NULL)
+		return false;
+	*slot = page;
+	return true;
+}
+
+/* page remove from spt table */
+void spt_remove_page(struct supplemental_page_table *spt, struct page *page)
+{
+	struct page **slot = spt_walk(spt, page->va, false);
+
+	ASSERT(slot != NULL && *slot == page);
+	*slot = NULL;
+	vm_dealloc_page(page);
+}
+
+/* Returns the lowest page in TABLE, a table at LEVEL whose first
+ * entry starts at BASE, whose address is in [VA, END). */
+static struct page *spt_next_in(void **table, int level, uintptr_t base, uintptr_t va,
+								uintptr_t end)
+{
+	uintptr_t span = (uintptr_t)1 << SPT_SHIFT(level);
+
+	for (size_t i = va > base ? (va - base) / span : 0; i < SPT_ENTRIES && base + i * span < end; i++)
+	{
+		struct page *page;
+
+		if (table[i] == NULL)
+			continue;
+		if (level == SPT_LEVELS - 1)
+			return table[i];
+		page = spt_next_in(table[i], level + 1, base + i * span, va, end);
+		if (page != NULL)
+			return page;
+	}
+	return NULL;
+}
+
+/* Returns SPT's page with the lowest address in [VA, END), which
+ * must be page-aligned, or NULL if there is none.  Walking a range
+ * with it skips every table with no page in it. */
+struct page *spt_next_page(struct supplemental_page_table *spt, void *va, void *end)
+{
+	ASSERT(pg_ofs(va) == 0);
+
+	if (spt->pages == NULL)
+		return NULL;
+	return spt_next_in(spt->pages, 0, 0, (uintptr_t)va, (uintptr_t)end);
+}
+
+/* Frees TABLE, a table at LEVEL, with the tables and pages under it. */
+static void spt_destroy_in(void **table, int level)
+{
+	for (size_t i = 0; i < SPT_ENTRIES; i++)
+	{
+		if (table[i] == NULL)
+			continue;
+		if (level == SPT_LEVELS - 1)
+			vm_dealloc_page(table[i]);
+		else
+			spt_destroy_in(table[i], level + 1);
+	}
+	palloc_free_page(table);
+}
+
+/* Destroys every page of SPT and frees its tables. */
+void spt_destroy_pages(struct supplemental_page_table *spt)
+{
+	if (spt->pages != NULL)
+		spt_destroy_in(spt->pages, 0);
+	spt->pages = NULL;
+}
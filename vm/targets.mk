@@ -2,4 +2,12 @@ vm_SRC = vm/vm.c          # Main api proxy
 vm_SRC += vm/uninit.c     # Uninitialized page
 vm_SRC += vm/anon.c       # Anonymous page
 vm_SRC += vm/file.c       # File mapped page
+vm_SRC += vm/vma.c        # Virtual memory areas
+vm_SRC += vm/spt.c        # Supplemental page table
+vm_SRC += vm/replace.c    # Page replacement policies
+vm_SRC += vm/ksm.c        # Same-page merging
+vm_SRC += vm/zswap.c      # Compressed swap pool
+vm_SRC += vm/text.c       # Shared executable pages
+vm_SRC += vm/kswapd.c     # Background page reclaim
+vm_SRC += vm/rss.c        # Resident sets and working sets
 vm_SRC += vm/inspect.c    # Testing utility
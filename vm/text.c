@@ -0,0 +1,87 @@
+/* text.c: Sharing read-only executable pages between processes.
+ *
+ * A frame that holds a page of a read-only ELF segment, as loaded by
+ * lazy_load_segment(), is entered in a table keyed by the
+ * executable's inode and the page's offset in it.  When another
+ * process faults on the same page of the same executable, vm.c maps
+ * that frame read-only instead of reading the file into a frame of
+ * its own.  The frame leaves the table when it is freed, after its
+ * last mapping is gone, or when it is evicted.  All of this is done
+ * with frame_lock held. */
+
+#include "vm/text.h"
+#include <hash.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "vm/vm.h"
+
+/* 읽기 전용 세그먼트 페이지를 담은 프레임들. (inode, offset, 길이)로 찾는다. */
+static struct hash text_table;
+
+static uint64_t text_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+	const struct frame *f = hash_entry(e, struct frame, text_elem);
+	uintptr_t inode = (uintptr_t)f->text_inode;
+
+	return hash_bytes(&inode, sizeof inode) ^ hash_int(f->text_ofs);
+}
+
+static bool text_less(const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED)
+{
+	const struct frame *a = hash_entry(a_, struct frame, text_elem);
+	const struct frame *b = hash_entry(b_, struct frame, text_elem);
+
+	if (a->text_inode != b->text_inode)
+		return (uintptr_t)a->text_inode < (uintptr_t)b->text_inode;
+	if (a->text_ofs != b->text_ofs)
+		return a->text_ofs < b->text_ofs;
+	return a->text_bytes < b->text_bytes;
+}
+
+void text_init(void)
+{
+	hash_init(&text_table, text_hash, text_less, NULL);
+}
+
+/* Returns the frame that holds the page AUX describes, or NULL if no
+ * process has it in memory. */
+struct frame *text_lookup(const struct aux_for_lazy_load *aux)
+{
+	struct frame key;
+	struct hash_elem *e;
+
+	key.text_inode = file_get_inode(aux->load_file);
+	key.text_ofs = aux->offset;
+	key.text_bytes = aux->read_bytes;
+	e = hash_find(&text_table, &key.text_elem);
+	return e != NULL ? hash_entry(e, struct frame, text_elem) : NULL;
+}
+
+/* Enters FRAME, just loaded with the page AUX describes, in the
+ * table, unless another frame already holds that page. */
+void text_insert(struct frame *frame, const struct aux_for_lazy_load *aux)
+{
+	ASSERT(frame->text_inode == NULL);
+
+	frame->text_inode = file_get_inode(aux->load_file);
+	frame->text_ofs = aux->offset;
+	frame->text_bytes = aux->read_bytes;
+	if (hash_insert(&text_table, &frame->text_elem) != NULL)
+	{
+		frame->text_inode = NULL;
+		return;
+	}
+	/* 실행 파일이 모두 닫혀도 같은 주소의 다른 inode와 헷갈리지 않도록
+	 * 프레임이 표에 있는 동안 inode를 열어 둔다. */
+	inode_reopen(frame->text_inode);
+}
+
+/* Forgets FRAME, which is about to be evicted or freed. */
+void text_remove(struct frame *frame)
+{
+	if (frame->text_inode == NULL)
+		return;
+	hash_delete(&text_table, &frame->text_elem);
+	inode_close(frame->text_inode);
+	frame->text_inode = NULL;
+}
@@ -10,6 +10,7 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "threads/mmu.h"
 
 static bool uninit_initialize(struct page *page, void *kva);
 static void uninit_destroy(struct page *page);
@@ -55,6 +56,32 @@ uninit_initialize(struct page *page, void *kva)
 		   (init ? init(page, aux) : true);
 }
 
+/* Turns the evicted PAGE back into an uninit page, so that its next
+ * fault loads it again through INIT and INITIALIZER, as uninit_new()
+ * set it up.  The rest of PAGE is left alone. */
+void uninit_revert(struct page *page, vm_initializer *init,
+				   enum vm_type type, void *aux,
+				   bool (*initializer)(struct page *, enum vm_type, void *))
+{
+	page->operations = &uninit_ops;
+	page->uninit = (struct uninit_page){
+		.init = init,
+		.type = type,
+		.aux = aux,
+		.page_initializer = initializer,
+	};
+}
+
+/* Transmutes PAGE like uninit_initialize(), but without calling its
+ * initialization callback, for a caller that has already loaded the
+ * page's contents into KVA. */
+bool uninit_initialize_loaded(struct page *page, void *kva)
+{
+	struct uninit_page *uninit = &page->uninit;
+
+	return uninit->page_initializer(page, uninit->type, kva);
+}
+
 /* Free the resources hold by uninit_page. Although most of pages are transmuted
  * to other page objects, it is possible to have uninit pages when the process
  * exit, which are never referenced during the execution.
@@ -70,5 +97,9 @@ uninit_destroy(struct page *page)
 	// struct aux_for_lazy_load *aux = (struct aux_for_lazy_load *)(uninit->aux);
 
 	// free(aux);
+
+	/* 공유 zero 페이지는 pml4_destroy()가 해제하면 안 되므로 매핑을 지운다. */
+	if (page->zero_mapped && page->owner->pml4 != NULL)
+		pml4_clear_page(page->owner->pml4, page->va);
 	return;
 }
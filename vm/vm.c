@@ -1,5 +1,6 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
@@ -7,10 +8,39 @@
 #include "include/userprog/process.h"
 #include "threads/mmu.h"
 #include "include/userprog/syscall.h"
+#include "threads/interrupt.h"
+#include "vm/replace.h"
+#include "vm/ksm.h"
+#include "vm/text.h"
+#include "vm/kswapd.h"
+#include "vm/rss.h"
+#include "devices/timer.h"
+#include "devices/disk.h"
+#include <round.h>
+#include <syscall-nr.h>
 
 /* -- project 3 : VM Swap in&out ------ */
 struct list frame_table;
-struct list_elem *start;
+
+/* Serializes frame allocation, eviction and release, so that a
+ * frame is not freed or refilled while another process swaps it
+ * out.  Frames are added to and removed from frame_table only with
+ * frame_lock held and interrupts off: walkers hold either one, and
+ * palloc's compaction pass, which cannot sleep on the lock, runs
+ * with interrupts off.  Eviction lets go of the lock while it writes
+ * its victims out; their frames are marked evicting meanwhile, and
+ * whoever would change or free them waits on evict_done. */
+static struct lock frame_lock;
+static struct condition evict_done;
+
+struct vm_stats vm_stats;
+
+/* -thp: 0으로 채울 anon 영역을 2MB 큰 페이지로 매핑한다. */
+bool thp_enabled;
+
+/* 모든 프로세스가 아직 쓰지 않은 0 페이지를 읽을 때 함께 매핑하는,
+ * 0으로 채워진 읽기 전용 페이지. 처음 쓸 때 진짜 프레임으로 바뀐다. */
+static void *zero_kva;
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -24,8 +54,15 @@ void vm_init(void)
 	register_inspect_intr();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	list_init(&frame_table);		  // 수정!
-	start = list_begin(&frame_table); // 수정!
+	list_init(&frame_table); // 수정!
+	replace_init();
+	lock_init(&frame_lock);
+	cond_init(&evict_done);
+	zero_kva = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+	ksm_init();
+	text_init();
+	kswapd_init();
+	rss_init();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -47,7 +84,27 @@ page_get_type(struct page *page)
 /* Helpers */
 static struct frame *vm_get_victim(void);
 static bool vm_do_claim_page(struct page *page);
-static struct frame *vm_evict_frame(void);
+static struct frame *vm_evict_frame(size_t *cnt);
+static size_t vm_return_lent_frames(void);
+static bool vm_fault_is_major(struct page *page);
+static bool vm_claim_with_readahead(struct page *page);
+static struct aux_for_lazy_load *vm_page_file_aux(struct page *page);
+static bool vm_claim_with_fault_around(struct page *page, struct aux_for_lazy_load *aux);
+static size_t vm_swap_in_run(struct page *page, size_t window, struct readahead *ra);
+static size_t vm_file_in_run(struct page *page, struct aux_for_lazy_load *aux, size_t window,
+							 struct readahead *ra);
+static void frame_link(struct frame *frame, struct page *page);
+static void frame_unshare(struct frame *frame, struct page *page);
+static bool vm_share_anon_page(struct page *child, struct page *parent);
+static bool vm_page_is_zero_fill(struct page *page);
+static bool vm_map_text(struct page *page);
+static bool vm_map_huge(struct supplemental_page_table *spt, void *addr);
+static struct frame *frame_new(void *kva);
+static void vm_drop_text(struct frame *frame);
+static void page_set_frame(struct page *page, struct frame *frame);
+static void frame_evicted(struct frame *victim);
+static void frame_evict_abort(struct frame *victim);
+static struct frame *vm_evict_own_frame(struct supplemental_page_table *spt);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -85,6 +142,18 @@ bool vm_alloc_page_with_initializer(enum vm_type type, void *upage, bool writabl
 #endif
 		}
 		page->writable = writable;
+		page->owner = thread_current();
+		page->evict_seq = 0;
+		page->readahead = NULL;
+		page->share_next = NULL;
+		page->zero_mapped = false;
+		page->young = false;
+		page->ws_epoch = 0;
+		/* 읽기 전용 세그먼트 페이지는 같은 실행 파일을 돌리는 프로세스끼리 공유한다. */
+		page->text = NULL;
+		if (type == VM_ANON && init == lazy_load_segment && !writable &&
+			((struct aux_for_lazy_load *)aux)->read_bytes > 0)
+			page->text = aux;
 
 		/* Insert the page into the spt. */
 		return spt_insert_page(spt, page);
@@ -93,87 +162,199 @@ err:
 	return false;
 }
 
-/* Find VA from spt and return page. On error, return NULL. */
-struct page *
-spt_find_page(struct supplemental_page_table *spt UNUSED, void *va UNUSED)
+/* Returns the page of SPT at VA like spt_find_page(), but makes it
+ * from the area that holds VA if it has not been touched before.
+ * Returns NULL if no area holds VA or memory runs out. */
+struct page *spt_get_page(struct supplemental_page_table *spt, void *va)
 {
-	struct page *page = page_lookup(va);
-	if (page)
-	{
+	struct page *page = spt_find_page(spt, va);
+	struct vma *vma;
+	size_t ofs;
+
+	if (page != NULL || (vma = vma_find(spt, va)) == NULL)
 		return page;
-	}
-	return NULL; /* 사용자가 엉뚱한 va 요청했을 때 */
-}
 
-/* Insert PAGE into spt with validation. */
-bool spt_insert_page(struct supplemental_page_table *spt UNUSED,
-					 struct page *page UNUSED)
-{
-	int succ = false;
-	if (!hash_insert(&spt->vm, &page->hash_elem))
+	va = pg_round_down(va);
+	ofs = va - vma->start;
+	/* 파일에서 읽을 페이지만 aux를 만든다. 0으로 채울 anon 페이지는 aux가 필요 없다. */
+	if (vma->file != NULL && (ofs < vma->read_bytes || VM_TYPE(vma->type) == VM_FILE))
 	{
-		succ = true;
-	}
-	return succ;
-}
+		struct aux_for_lazy_load *aux = (struct aux_for_lazy_load *)malloc(sizeof(struct aux_for_lazy_load));
+		if (aux == NULL)
+			return NULL;
 
-/* page remove from spt table */
-void spt_remove_page(struct supplemental_page_table *spt, struct page *page)
-{
-	hash_delete(&spt->vm, &page->hash_elem);
-	vm_dealloc_page(page);
-	return true;
+		aux->load_file = vma->file;
+		aux->offset = vma->offset + ofs;
+		aux->read_bytes = ofs >= vma->read_bytes ? 0 : vma->read_bytes - ofs < PGSIZE ? vma->read_bytes - ofs : PGSIZE;
+		aux->zero_bytes = PGSIZE - aux->read_bytes;
+		if (!vm_alloc_page_with_initializer(vma->type, va, vma->writable, lazy_load_segment, aux))
+		{
+			free(aux);
+			return NULL;
+		}
+	}
+	else if (!vm_alloc_page(vma->type, va, vma->writable))
+		return NULL;
+	return spt_find_page(spt, va);
 }
 
 /* Get the struct frame, that will be evicted. */
+/* 어떤 프레임을 내보낼지는 -vm-policy로 고른 교체 정책이 정한다. */
 static struct frame *
 vm_get_victim(void)
 {
-	struct frame *victim = NULL;
-	/* TODO: The policy for eviction is up to you. */
-	// PJ3
-	struct thread *current_thread = thread_current();
-	struct list_elem *search_elem = start; // start는 vm_init에서 list_begin으로 초기화해줬다.
+	return replace_victim();
+}
+/* Evict one page and return the corresponding frame.
+ * Return NULL on error.*/
+/* 한 번에 최대 SWAP_CLUSTER_MAX개의 victim을 모아 내보낸다.
+ * anon 페이지들은 이웃한 swap slot에 disk 명령 하나로 쓰고,
+ * 첫 프레임은 호출자에게, 나머지는 palloc에 돌려준다.
+ * 그러면 다음 몇 번의 vm_get_frame()은 eviction 없이 끝난다.
+ * 내보낸 프레임 수를 *CNT에 쓴다. frame_lock을 쥐고 부르지만,
+ * 디스크에 쓰는 동안은 잠시 놓는다. */
+static struct frame *vm_evict_frame(size_t *cnt)
+{
+	struct frame *victims[SWAP_CLUSTER_MAX];
+	struct page *anon[SWAP_CLUSTER_MAX];
+	size_t victim_cnt = 0, anon_cnt = 0;
+	struct frame *result = NULL;
 
-	for (start = search_elem; start != list_end(&frame_table); start = list_next(start))
+	*cnt = 0;
+	/* 고른 프레임은 pin해 두어야 다음 vm_get_victim()이 다른 것을 고른다. */
+	while (victim_cnt < SWAP_CLUSTER_MAX)
 	{
-		victim = list_entry(start, struct frame, frame_elem);
+		struct frame *victim = vm_get_victim();
+		if (victim == NULL)
+			break;
 
-		if (pml4_is_accessed(current_thread->pml4, victim->page->va))
-		{
-			pml4_set_accessed(current_thread->pml4, victim->page->va, 0);
-		}
-		else
-		{
-			return victim;
-		}
+		victim->pinned = true;
+		victim->evicting = true;
+		victims[victim_cnt++] = victim;
+		if (VM_TYPE(victim->page->operations->type) == VM_ANON && victim->text_inode == NULL)
+			anon[anon_cnt++] = victim->page;
 	}
 
-	for (start = list_begin(&frame_table); start != search_elem; start = list_next(start))
+	bool clustered = anon_cnt > 0 && anon_swap_out_cluster(anon, anon_cnt);
+
+	for (size_t i = 0; i < victim_cnt; i++)
 	{
-		victim = list_entry(start, struct frame, frame_elem);
+		struct frame *victim = victims[i];
+		struct page *page = victim->page;
+		bool is_anon = VM_TYPE(page->operations->type) == VM_ANON;
 
-		if (pml4_is_accessed(current_thread->pml4, victim->page->va))
+		/* 실행 파일 페이지는 파일에서 다시 읽으면 되므로 그냥 버린다.
+		 * 묶어 쓰기에 실패했으면 한 페이지씩 내보낸다. */
+		if (victim->text_inode != NULL)
+			vm_drop_text(victim);
+		else if (!(is_anon && clustered) && !swap_out(page))
 		{
-			pml4_set_accessed(current_thread->pml4, victim->page->va, 0);
+			frame_evict_abort(victim);
+			continue;
 		}
+		frame_evicted(victim);
+		(*cnt)++;
+
+		if (result == NULL)
+			result = victim;
 		else
-		{
-			return victim;
-		}
+			vm_free_frame(victim);
 	}
 
-	return victim;
+	return result;
 }
-/* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
-static struct frame *vm_evict_frame(void)
+
+/* Detaches VICTIM, whose contents have just been written out or
+ * dropped, from the policy lists and from every page that mapped it.
+ * Called with frame_lock held. */
+static void frame_evicted(struct frame *victim)
+{
+	struct page *page = victim->page;
+
+	replace_remove(victim);
+	ksm_remove(victim);
+	text_remove(victim);
+	/* 공유 중이던 페이지들도 모두 함께 쫓겨났다. */
+	size_t seq = ++vm_stats.evictions;
+	while (page != NULL)
+	{
+		struct page *next = page->share_next;
+
+		vm_readahead_settle(page, false);
+		page->evict_seq = seq;
+		page_set_frame(page, NULL);
+		page->share_next = NULL;
+		page = next;
+	}
+	victim->page = NULL;
+	victim->ref_cnt = 0;
+	victim->evicting = false;
+	cond_broadcast(&evict_done, &frame_lock);
+}
+
+/* Leaves VICTIM, which could not be written out, to its pages.
+ * Called with frame_lock held. */
+static void frame_evict_abort(struct frame *victim)
+{
+	victim->pinned = false;
+	victim->evicting = false;
+	cond_broadcast(&evict_done, &frame_lock);
+}
+
+/* Evicts one of the pages of the process that owns SPT, for a
+ * process over its -rss-limit: the next page after the one evicted
+ * last that is not shared, not pinned and, second chance, was not
+ * used since it was last looked at.  Returns the frame, pinned, or
+ * NULL if the process has nothing to give.  Called with frame_lock
+ * held. */
+static struct frame *vm_evict_own_frame(struct supplemental_page_table *spt)
 {
-	struct frame *victim UNUSED = vm_get_victim();
-	/* TODO: swap out the victim and return the evicted frame. */
-	swap_out(victim->page);
+	void *va = spt->reclaim_cursor;
+	int wraps = 0;
 
-	return victim;
+	/* 한 바퀴는 accessed 비트만 지우고 지나갈 수 있으니 끝에서 두 번까지 처음으로 돌아간다. */
+	for (;;)
+	{
+		struct page *page = spt_next_page(spt, va, (void *)KERN_BASE);
+
+		if (page == NULL)
+		{
+			if (++wraps > 2)
+				break;
+			va = NULL;
+			continue;
+		}
+		va = page->va + PGSIZE;
+
+		struct frame *frame = page->frame;
+		uint64_t *pml4 = page->owner->pml4;
+
+		if (frame == NULL || frame->ref_cnt != 1 || frame->pinned)
+			continue;
+		if (pml4_is_accessed(pml4, page->va) || page->young)
+		{
+			pml4_set_accessed(pml4, page->va, false);
+			page->young = false;
+			vm_readahead_settle(page, true);
+			rss_note_access(page);
+			continue;
+		}
+
+		frame->pinned = true;
+		frame->evicting = true;
+		if (frame->text_inode != NULL)
+			vm_drop_text(frame);
+		else if (!swap_out(page))
+		{
+			frame_evict_abort(frame);
+			continue;
+		}
+		spt->reclaim_cursor = va;
+		frame_evicted(frame);
+		spt->rss_reclaims++;
+		return frame;
+	}
+	return NULL;
 }
 
 /* palloc() and get frame. If there is no available page(frame), evict the page
@@ -184,51 +365,448 @@ static struct frame *vm_evict_frame(void)
  * 만약 가용한 페이지가 없으면 페이지를 제거하고 반환한다.
  * 해당 함수는 항상 valid한 주소를 반환해야한다.
  * (user pool 메모리가 가득찬 경우,
- * 프레임을 제거해서 가용한 메모리 공간을 확보해야한다.) */
+ * 프레임을 제거해서 가용한 메모리 공간을 확보해야한다.)
+ * 반환된 프레임은 pinned 상태이고, 내보낼 프레임이 없으면 NULL이다. */
 static struct frame *vm_get_frame(void)
 {
 	struct frame *frame = NULL;
 	/* TODO: Fill this function. */
-	frame = (struct frame *)malloc(sizeof(struct frame));
+	struct supplemental_page_table *spt = &thread_current()->spt;
 
-	frame->kva = palloc_get_page(PAL_USER); /* USER POOL에서 커널 가상 주소 공간으로 1page 할당 */
+	/* kswapd가 없으면 커널 pool에서 빌린 프레임도 여기서 돌려준다. */
+	if (!kswapd_enabled())
+	{
+		lock_acquire(&frame_lock);
+		vm_return_lent_frames();
+		lock_release(&frame_lock);
+	}
+
+	/* -rss-limit을 넘었으면 다른 프로세스보다 자기 페이지를 먼저 내보낸다. */
+	if (rss_limit_pages > 0 && spt->rss >= rss_limit_pages)
+	{
+		lock_acquire(&frame_lock);
+		frame = vm_evict_own_frame(spt);
+		lock_release(&frame_lock);
+		if (frame != NULL)
+			return frame;
+	}
+
+	void *kva = palloc_get_page(PAL_USER); /* USER POOL에서 커널 가상 주소 공간으로 1page 할당 */
 
 	/* if 프레임이 꽉 차서 할당받을 수 없다면 페이지 교체 실시
 	   else 성공했다면 frame 구조체 커널 주소 멤버에 위에서 할당받은 메모리 커널 주소 넣기 */
-	if (frame->kva == NULL)
+	if (kva == NULL)
 	{
-		frame = vm_evict_frame(); // 수정!
-		frame->page = NULL;
+		/* kswapd가 따라오지 못했으니 fault난 프로세스가 직접 내보낸다. */
+		size_t cnt;
 
+		lock_acquire(&frame_lock);
+		frame = vm_evict_frame(&cnt); // 수정!
+		vm_stats.direct_reclaims++;
+		vm_stats.direct_pages += cnt;
+		lock_release(&frame_lock);
+		kswapd_check();
 		return frame;
 	}
+	kswapd_check();
+
+	frame = frame_new(kva);
+	if (frame == NULL)
+		palloc_free_page(kva);
+	return frame;
+}
+
+/* Makes a frame table entry for the user page at KVA, pinned and
+ * not mapped by any page yet.  Returns NULL if memory runs out. */
+static struct frame *frame_new(void *kva)
+{
+	struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
+	if (frame == NULL)
+		return NULL;
+
 	/* 새 프레임을 프레임 테이블에 넣어 관리한다. */
+	frame->kva = kva;
+	frame->page = NULL;
+	frame->ref_cnt = 0;
+	frame->pinned = true;
+	frame->evicting = false;
+	frame->huge = false;
+	frame->lru = FRAME_UNLISTED;
+	frame->ksm_hashed = false;
+	frame->ksm_listed = false;
+	frame->text_inode = NULL;
+	lock_acquire(&frame_lock);
+	enum intr_level old_level = intr_disable();
 	list_push_back(&frame_table, &frame->frame_elem);
+	intr_set_level(old_level);
+	lock_release(&frame_lock);
+	return frame;
+}
+
+/* Gives frames back to palloc for kswapd: the ones the kernel pool
+ * lent, if it wants them back, and one evicted cluster.  Returns the
+ * number of frames freed. */
+size_t vm_reclaim(void)
+{
+	struct frame *frame;
+	size_t freed, cnt;
+
+	lock_acquire(&frame_lock);
+	freed = vm_return_lent_frames();
+	frame = vm_evict_frame(&cnt);
+	if (frame != NULL)
+		vm_free_frame(frame);
+	lock_release(&frame_lock);
+	return freed + cnt;
+}
+
+/* Swap out user frames that the kernel pool lent to the user pool
+ * while the kernel pool is below its low watermark, and give the
+ * pages back.  Returns the number given back.  Called with
+ * frame_lock held. */
+static size_t vm_return_lent_frames(void)
+{
+	size_t want = palloc_reclaim_wanted(0);
+	size_t returned = 0;
+	struct list_elem *e = list_begin(&frame_table);
 
+	while (want > 0 && e != list_end(&frame_table))
+	{
+		struct frame *frame = list_entry(e, struct frame, frame_elem);
+		e = list_next(e);
+
+		if (!palloc_is_lent(frame->kva) || frame->page == NULL ||
+			frame->pinned)
+			continue;
+
+		frame->pinned = true;
+		if (!swap_out(frame->page))
+		{
+			frame->pinned = false;
+			continue;
+		}
+		vm_free_frame(frame);
+		want--;
+		returned++;
+	}
+	return returned;
+}
+
+/* Makes PAGE the only page mapping FRAME. */
+static void frame_link(struct frame *frame, struct page *page)
+{
+	frame->page = page;
+	frame->ref_cnt = 1;
+	page_set_frame(page, frame);
+	page->share_next = NULL;
+}
+
+/* Sets the frame of PAGE, keeping the resident set size of its
+ * owner up to date. */
+static void page_set_frame(struct page *page, struct frame *frame)
+{
+	struct supplemental_page_table *spt = &page->owner->spt;
+
+	/* 다른 프로세스의 eviction도 세므로 인터럽트를 끄고 고친다. */
+	enum intr_level old_level = intr_disable();
+	if (page->frame == NULL && frame != NULL)
+	{
+		if (++spt->rss > spt->rss_peak)
+			spt->rss_peak = spt->rss;
+	}
+	else if (page->frame != NULL && frame == NULL)
+		spt->rss--;
+	intr_set_level(old_level);
+	page->frame = frame;
+	page->young = false;
+}
+
+/* Detaches PAGE from FRAME and unmaps it from its owner's page
+ * table.  FRAME itself is left alone. */
+static void page_unmap_frame(struct page *page, struct frame *frame)
+{
+	uint64_t *pml4 = page->owner->pml4;
+
+	if (page->readahead)
+		vm_readahead_settle(page, pml4 != NULL && pml4_is_accessed(pml4, page->va));
+	page_set_frame(page, NULL);
+	page->share_next = NULL;
+	/* pml4_destroy()가 같은 페이지를 또 해제하지 않도록 매핑을 지운다. */
+	if (pml4 != NULL && pml4_get_page(pml4, page->va) == frame->kva)
+		pml4_clear_page(pml4, page->va);
+}
+
+/* Takes PAGE off the list of pages sharing FRAME, which must have
+ * at least one other.  Called with frame_lock held. */
+static void frame_unshare(struct frame *frame, struct page *page)
+{
+	struct page **pp = &frame->page;
+
+	ASSERT(frame->ref_cnt > 1);
+	while (*pp != page)
+		pp = &(*pp)->share_next;
+	*pp = page->share_next;
+	frame->ref_cnt--;
+	page_unmap_frame(page, frame);
+}
+
+/* Releases FRAME: unmaps it from every process that maps it, gives
+ * the memory back to palloc and drops the frame table entry.
+ * Called with frame_lock held. */
+void vm_free_frame(struct frame *frame)
+{
+	struct page *page = frame->page;
+
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	while (page != NULL)
+	{
+		struct page *next = page->share_next;
+
+		page_unmap_frame(page, frame);
+		page = next;
+	}
 	frame->page = NULL;
+	frame->ref_cnt = 0;
+
+	replace_remove(frame);
+	ksm_remove(frame);
+	text_remove(frame);
+	enum intr_level old_level = intr_disable();
+	list_remove(&frame->frame_elem);
+	intr_set_level(old_level);
+
+	palloc_free_page(frame->kva);
+	free(frame);
+}
+
+/* Lets code outside this file, such as ksmd, walk and change the
+ * frame table the way the functions here do. */
+void vm_lock_frames(void)
+{
+	lock_acquire(&frame_lock);
+}
 
-	ASSERT(frame != NULL);
-	ASSERT(frame->page == NULL);
+void vm_unlock_frames(void)
+{
+	lock_release(&frame_lock);
+}
+
+/* Releases frame_lock for the write that swaps out PAGES, if the
+ * frames of all of them are being evicted, so that processes that
+ * only need a free frame do not wait for the disk.  Returns true if
+ * it did; the caller takes the lock back with vm_lock_frames(). */
+bool vm_unlock_frames_for_io(struct page *pages[], size_t cnt)
+{
+	ASSERT(lock_held_by_current_thread(&frame_lock));
+
+	for (size_t i = 0; i < cnt; i++)
+		if (!pages[i]->frame->evicting)
+			return false;
+	lock_release(&frame_lock);
+	return true;
+}
+
+/* Waits until the frame of PAGE, if any, is not being evicted.
+ * PAGE then has either no frame or the one it had.  Called with
+ * frame_lock held. */
+void vm_wait_evicted(struct page *page)
+{
+	while (page->frame != NULL && page->frame->evicting)
+		cond_wait(&evict_done, &frame_lock);
+}
+
+/* Frees the frame holding PAGE, if it has one and no other process
+ * still shares it.  PAGE->frame is read under frame_lock, so a
+ * concurrent eviction of PAGE either finishes first (and leaves
+ * nothing to free) or has not picked it yet. */
+void vm_page_release_frame(struct page *page)
+{
+	lock_acquire(&frame_lock);
+	vm_wait_evicted(page);
+	if (page->frame != NULL && page->frame->ref_cnt > 1)
+		frame_unshare(page->frame, page);
+	else if (page->frame != NULL)
+		vm_free_frame(page->frame);
+	lock_release(&frame_lock);
+}
+
+/* Returns the frame table entry for KVA, or NULL. */
+static struct frame *frame_lookup(void *kva)
+{
+	struct list_elem *e;
+
+	for (e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e))
+	{
+		struct frame *frame = list_entry(e, struct frame, frame_elem);
+		if (frame->kva == kva)
+			return frame;
+	}
+	return NULL;
+}
+
+/* Calls FUNC with the kernel address of every user frame that
+ * vm_migrate_frame() may move.  Frames under I/O are pinned, and
+ * those of a huge page would have to split it, which allocates.
+ * Called by palloc's compaction pass with interrupts off. */
+void vm_for_each_movable_frame(void (*func)(void *kva, void *aux), void *aux)
+{
+	struct list_elem *e;
+
+	for (e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e))
+	{
+		struct frame *frame = list_entry(e, struct frame, frame_elem);
+		if (frame->page != NULL && !frame->pinned && !frame->huge)
+			func(frame->kva, aux);
+	}
+}
+
+/* Points PAGE's mapping in its owner's page table at TO, if it
+ * maps FROM.  The accessed and dirty bits are carried over. */
+static void migrate_mapping(struct page *page, void *from, void *to)
+{
+	uint64_t *pml4 = page->owner->pml4;
+	uint64_t *pte;
+
+	if (pml4 == NULL || pml4_get_page(pml4, page->va) != from)
+		return;
+
+	pte = pml4e_walk(pml4, (uint64_t)page->va, 0);
+	bool writable = is_writable(pte);
+	bool dirty = (*pte & PTE_D) != 0;
+	bool accessed = (*pte & PTE_A) != 0;
+
+	pml4_set_page(pml4, page->va, to, writable);
+	pml4_set_dirty(pml4, page->va, dirty);
+	pml4_set_accessed(pml4, page->va, accessed);
+}
+
+/* Moves the user frame at FROM to the free page TO, and updates
+ * every page table that maps it.  Must be called with interrupts
+ * off, on a frame vm_for_each_movable_frame() reported. */
+void vm_migrate_frame(void *from, void *to)
+{
+	struct frame *frame = frame_lookup(from);
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(frame != NULL && frame->page != NULL && !frame->pinned);
+
+	memcpy(to, from, PGSIZE);
+	for (struct page *page = frame->page; page != NULL; page = page->share_next)
+		migrate_mapping(page, from, to);
+	frame->kva = to;
+}
+
+/* Makes KVA, a user page from palloc, the frame of PAGE, which has
+ * none, unpinned and on no policy list, the way a fault would leave
+ * it.  For tests that need user frames without a user process; the
+ * frame is released with vm_page_release_frame().  Returns NULL if
+ * memory runs out. */
+struct frame *vm_test_frame(struct page *page, void *kva)
+{
+	struct frame *frame = frame_new(kva);
+
+	if (frame == NULL)
+		return NULL;
+	frame_link(frame, page);
+	frame->pinned = false;
 	return frame;
 }
 
 /* Growing the stack. */
+/* 어느 영역에도 없는 ADDR 바로 위가 스택 영역이면 ADDR가 든 페이지까지 아래로 늘린다.
+ * 늘어난 페이지들은 다른 영역처럼 처음 건드릴 때 만든다. */
 static bool
 vm_stack_growth(void *addr UNUSED)
 {
-	if (vm_alloc_page(VM_MARKER_0 | VM_ANON, addr, true))
-	{
-		thread_current()->stack_bottom -= PGSIZE;
-		return true;
-	}
+	struct vma *stack = vma_lookup(&thread_current()->spt, addr);
 
-	return false;
+	if (stack == NULL || !(stack->type & VM_MARKER_0))
+		return false;
+
+	/* 사이에 다른 영역이 없으니 start를 낮춰도 트리의 순서는 그대로다. */
+	stack->start = pg_round_down(addr);
+	return true;
+}
+
+/* Returns the area of the current process that holds ADDR.  An
+ * address in no area is only taken as a push just below the stack
+ * (at most 1 MB below USER_STACK), given the user stack pointer
+ * RSP; the stack is then grown down to it.  Returns NULL if ADDR is
+ * not valid user memory. */
+struct vma *vm_find_area(void *addr, uintptr_t rsp)
+{
+	struct vma *vma = vma_find(&thread_current()->spt, addr);
+
+	if (vma != NULL)
+		return vma;
+	if ((uintptr_t)addr < USER_STACK - (1 << 20) || (uintptr_t)addr >= USER_STACK || (uintptr_t)addr + 8 < rsp ||
+		!vm_stack_growth(addr))
+		return NULL;
+	return vma_find(&thread_current()->spt, addr);
 }
 
 /* Handle the fault on write_protected page */
+/* fork 뒤에 다른 프로세스와 읽기 전용으로 공유하던 PAGE에 쓰려고 했다.
+ * 혼자 남았으면 그 프레임을 다시 쓰기 가능으로 매핑하고,
+ * 아니면 새 프레임에 복사해서 떼어 낸다. */
 static bool
-vm_handle_wp(struct page *page UNUSED)
+vm_handle_wp(struct page *page)
 {
+	uint64_t *pml4 = page->owner->pml4;
+	struct frame *frame = NULL;
+	struct frame *old;
+
+	/* zero 페이지에 처음 쓰려는 것이면 이제야 프레임을 받아 초기화한다. */
+	if (page->zero_mapped)
+		return vm_do_claim_page(page);
+
+	/* 새 프레임은 eviction을 할 수도 있으니 frame_lock 없이 받는다.
+	   그 사이에 PAGE가 쫓겨났거나 다른 공유자가 떠났을 수 있으므로 다시 본다. */
+	lock_acquire(&frame_lock);
+	vm_wait_evicted(page);
+	if (page->frame != NULL && page->frame->ref_cnt > 1)
+	{
+		lock_release(&frame_lock);
+		frame = vm_get_frame();
+		if (frame == NULL)
+			return false;
+		lock_acquire(&frame_lock);
+		vm_wait_evicted(page);
+	}
+
+	old = page->frame;
+	if (old == NULL)
+	{
+		/* 쫓겨났다. 다시 접근하면 not-present fault로 읽어 온다. */
+	}
+	else if (old->ref_cnt == 1)
+	{
+		pml4_set_page(pml4, page->va, old->kva, true);
+		vm_stats.cow_reuses++;
+	}
+	else
+	{
+		ASSERT(frame != NULL);
+		/* palloc의 compaction이 복사하는 도중에 OLD를 옮기지 않도록 pin한다. */
+		bool pinned = old->pinned;
+		old->pinned = true;
+		memcpy(frame->kva, old->kva, PGSIZE);
+		old->pinned = pinned;
+		frame_unshare(old, page);
+		frame_link(frame, page);
+		pml4_set_page(pml4, page->va, frame->kva, true);
+		replace_insert(frame);
+		frame->pinned = false;
+		frame = NULL;
+		vm_stats.cow_copies++;
+	}
+
+	/* 쓰지 않은 새 프레임은 돌려준다. */
+	if (frame != NULL)
+		vm_free_frame(frame);
+	lock_release(&frame_lock);
+	return true;
 }
 
 /* Return true on success */
@@ -239,33 +817,797 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED,
 	struct supplemental_page_table *spt UNUSED = &thread_current()->spt;
 	struct page *page = NULL;
 	/* Validate the fault */
-	if (!addr || is_kernel_vaddr(addr) || !not_present)
+	if (!addr || is_kernel_vaddr(addr))
 	{
 		return false;
 	}
 
 	page = spt_find_page(spt, addr);
 
-	if (!page)
+	/* 다른 스레드가 내보내는 중인 페이지면 다 쓸 때까지 기다린다.
+	   내보내지 못했다면 매핑이 되돌려졌으니 다시 접근하면 된다. */
+	if (not_present && page != NULL && page->frame != NULL)
+	{
+		lock_acquire(&frame_lock);
+		bool evicting = page->frame != NULL && page->frame->evicting;
+		vm_wait_evicted(page);
+		bool restored = evicting && page->frame != NULL;
+		lock_release(&frame_lock);
+		if (restored)
+			return true;
+	}
+
+	/* 있는 페이지에 쓰다가 난 fault는 copy-on-write로 공유 중인 페이지일 때만 처리한다. */
+	if (!not_present)
+	{
+		if (!write || !page || !page->writable)
+			return false;
+		return vm_handle_wp(page);
+	}
+
+	/* system call 중의 fault라면 f->rsp는 커널 스택이므로 들어올 때의 유저 rsp를 본다. */
+	if (!page && vm_find_area(addr, user ? f->rsp : (uintptr_t)thread_current()->user_rsp) == NULL)
+		return false;
+	/* 2MB 범위를 처음 건드린 것이면 큰 페이지 하나로 한꺼번에 매핑해 본다. */
+	if (!page && vm_map_huge(spt, addr))
+	{
+		vm_stats.minor_faults++;
+		spt->minor_faults++;
+		if (spt->exec_start != -1)
+			spt->exec_faults++;
+		return true;
+	}
+	/* 처음 건드리는 페이지면 영역에서 struct page를 만든다. */
+	if (!page && (page = spt_get_page(spt, addr)) == NULL)
+		return false;
+	/* 다른 프로세스가 이미 읽어 둔 실행 파일 페이지면 그 프레임을 함께 매핑한다. */
+	bool shared = vm_map_text(page);
+
+	if (!shared && vm_fault_is_major(page))
+	{
+		vm_stats.major_faults++;
+		spt->major_faults++;
+	}
+	else
 	{
-		if (addr >= USER_STACK - (1 << 20) && USER_STACK > addr && addr >= f->rsp - 8 && addr < thread_current()->stack_bottom)
+		vm_stats.minor_faults++;
+		spt->minor_faults++;
+	}
+	if (spt->exec_start != -1)
+		spt->exec_faults++;
+	if (shared)
+		return true;
+
+	/* 0으로 채울 페이지를 읽기만 하면 프레임 대신 zero 페이지를 보여 준다. */
+	if (!write && vm_page_is_zero_fill(page))
+	{
+		if (!pml4_set_page(page->owner->pml4, page->va, zero_kva, false))
+			return false;
+		page->zero_mapped = true;
+		vm_stats.zero_maps++;
+		return true;
+	}
+
+	if (VM_TYPE(page->operations->type) == VM_ANON && page->anon.swap_index != -1)
+		return vm_claim_with_readahead(page);
+	struct aux_for_lazy_load *aux = vm_page_file_aux(page);
+	if (aux != NULL && spt->fault_around.max > 0)
+		return vm_claim_with_fault_around(page, aux);
+	return vm_do_claim_page(page);
+}
+
+/* Maps the 2 MB range holding ADDR with one huge page, if -thp is on
+ * and the whole range lies in one writable area of zero-filled
+ * anonymous memory none of whose pages has been made yet.  Each of
+ * the small pages still gets its own struct page and frame, so that
+ * eviction, fork, KSM and madvise() handle them as usual; the page
+ * table splits the huge page the first time one of them is unmapped
+ * or remapped alone.  Returns false to fall back to a small page. */
+static bool vm_map_huge(struct supplemental_page_table *spt, void *addr)
+{
+	void *base = (void *)ROUND_DOWN((uintptr_t)addr, HPAGE_SIZE);
+	struct vma *vma = vma_find(spt, addr);
+	size_t made;
+	void *kva;
+
+	if (!thp_enabled || vma == NULL || VM_TYPE(vma->type) != VM_ANON || !vma->writable ||
+		base < vma->start || base + HPAGE_SIZE > vma->end ||
+		(rss_limit_pages > 0 && spt->rss + HPAGE_CNT > rss_limit_pages) ||
+		(vma->file != NULL && (size_t)(base - vma->start) < vma->read_bytes) ||
+		spt_next_page(spt, base, base + HPAGE_SIZE) != NULL)
+		return false;
+
+	/* 정렬된 2MB가 비어 있지 않으면 4KB 페이지로 물러선다. */
+	kva = palloc_get_aligned(PAL_USER | PAL_ZERO, HPAGE_CNT);
+	kswapd_check();
+	if (kva == NULL)
+	{
+		vm_stats.huge_fallbacks++;
+		return false;
+	}
+
+	for (made = 0; made < HPAGE_CNT; made++)
+	{
+		void *va = base + made * PGSIZE;
+		struct frame *frame;
+		struct page *page;
+
+		if (!vm_alloc_page(vma->type, va, true) || (frame = frame_new(kva + made * PGSIZE)) == NULL)
+			break;
+		page = spt_find_page(spt, va);
+		uninit_initialize_loaded(page, frame->kva);
+		frame->huge = true;
+		frame_link(frame, page);
+	}
+
+	if (made < HPAGE_CNT || !pml4_set_huge_page(thread_current()->pml4, base, kva, true))
+	{
+		/* 만든 페이지를 지우면 그 프레임도 돌아가고, 나머지 메모리는 직접 돌려준다. */
+		for (size_t i = 0; i < HPAGE_CNT; i++)
 		{
-			void *fpage = thread_current()->stack_bottom - PGSIZE;
-			if (vm_stack_growth(fpage))
-			{
-				page = spt_find_page(spt, fpage);
-			}
-			else
+			struct page *page = spt_find_page(spt, base + i * PGSIZE);
+
+			if (page != NULL)
+				spt_remove_page(spt, page);
+			if (i >= made)
+				palloc_free_page(kva + i * PGSIZE);
+		}
+		vm_stats.huge_fallbacks++;
+		return false;
+	}
+
+	for (size_t i = 0; i < HPAGE_CNT; i++)
+	{
+		struct frame *frame = spt_find_page(spt, base + i * PGSIZE)->frame;
+
+		replace_insert(frame);
+		frame->pinned = false;
+	}
+	vm_stats.huge_faults++;
+	return true;
+}
+
+/* Records whether PAGE, brought in by readahead or fault-around, was
+ * USED before it was looked at again, and charges the outcome to the
+ * window that read it.  Does nothing for other pages. */
+void vm_readahead_settle(struct page *page, bool used)
+{
+	struct readahead *ra = page->readahead;
+
+	if (ra == NULL)
+		return;
+	page->readahead = NULL;
+	if (used)
+	{
+		ra->hits++;
+		ra->stats->hits++;
+	}
+	else
+	{
+		ra->misses++;
+		ra->stats->misses++;
+	}
+}
+
+/* 직전 창 RA에서 아직 판정되지 않은 페이지를 accessed 비트로 판정하고,
+ * 그동안의 hit/miss에 따라 창 크기를 조정한다.
+ * 모두 쓰였으면 두 배로 늘리고, 절반 넘게 버려졌으면 절반으로 줄인다. */
+static void vm_readahead_adapt(struct readahead *ra)
+{
+	struct thread *curr = thread_current();
+
+	lock_acquire(&frame_lock);
+	for (size_t i = 0; i < ra->cnt; i++)
+	{
+		void *va = ra->start + i * PGSIZE;
+		struct page *page = spt_find_page(&curr->spt, va);
+
+		if (page != NULL && page->readahead == ra && page->frame != NULL)
+			vm_readahead_settle(page, pml4_is_accessed(curr->pml4, va));
+	}
+	ra->cnt = 0;
+
+	if (ra->hits + ra->misses > 0)
+	{
+		if (ra->misses == 0)
+			ra->window = ra->window * 2 > ra->max ? ra->max : ra->window * 2;
+		else if (ra->hits < ra->misses && ra->window > 1)
+			ra->window /= 2;
+	}
+	ra->hits = ra->misses = 0;
+	lock_release(&frame_lock);
+}
+
+/* Starts a window of at most MAX pages, reporting to STATS. */
+static void vm_readahead_init(struct readahead *ra, size_t max, struct readahead_stats *stats)
+{
+	ra->max = max;
+	ra->window = max < 4 ? max : 4;
+	ra->hits = ra->misses = 0;
+	ra->start = NULL;
+	ra->cnt = 0;
+	ra->stats = stats;
+}
+
+/* Tells the replacement policy that the resident pages among the CNT
+ * pages from START will not be used again soon, so that it evicts
+ * them before anything else.  Frames shared with other processes
+ * are left alone. */
+static void vm_deactivate_range(void *start, size_t cnt)
+{
+	struct thread *curr = thread_current();
+
+	lock_acquire(&frame_lock);
+	for (size_t i = 0; i < cnt; i++)
+	{
+		struct page *page = spt_find_page(&curr->spt, start + i * PGSIZE);
+		struct frame *frame = page != NULL ? page->frame : NULL;
+
+		if (frame == NULL || frame->pinned || frame->ref_cnt > 1)
+			continue;
+		pml4_set_accessed(curr->pml4, page->va, false);
+		page->young = false;
+		replace_deactivate(frame);
+		vm_stats.deactivated++;
+	}
+	lock_release(&frame_lock);
+}
+
+/* Settles RA's last window and returns how many pages to read along
+ * with the faulting PAGE, following the madvise() advice for its
+ * area: none
+ * for MADV_RANDOM, RA's limit for MADV_SEQUENTIAL and the adaptive
+ * window otherwise.  A sequential reader is done with the run of
+ * pages before the one it has just finished, so those are evicted
+ * first. */
+static size_t vm_readahead_begin(struct readahead *ra, struct page *page)
+{
+	struct vma *vma = vma_find(&thread_current()->spt, page->va);
+
+	vm_readahead_adapt(ra);
+
+	switch (vma != NULL ? vma->advice : MADV_NORMAL)
+	{
+	case MADV_RANDOM:
+		return 0;
+	case MADV_SEQUENTIAL:
+	{
+		/* 방금 읽은 창 바로 앞의 창만큼을 내보낼 후보로 돌린다. */
+		size_t run = ra->max + 1;
+
+		if ((uintptr_t)page->va >= 2 * run * PGSIZE)
+			vm_deactivate_range(page->va - 2 * run * PGSIZE, run);
+		return ra->max;
+	}
+	default:
+		return ra->window;
+	}
+}
+
+/* Handles a major fault on the swapped-out anonymous PAGE, reading in
+ * a window of the pages after it with it (see vm_swap_in_run()). */
+/* 창 크기는 vm_readahead_adapt()가 hit/miss를 보고 정한다. */
+static bool vm_claim_with_readahead(struct page *page)
+{
+	struct readahead *ra = &thread_current()->spt.swap_ra;
+
+	return vm_swap_in_run(page, vm_readahead_begin(ra, page), ra) > 0;
+}
+
+/* Reads in the swapped-out anonymous PAGE together with up to WINDOW
+ * following virtual pages whose swap slots directly follow PAGE's
+ * (typically swapped out in the same cluster), with the same disk
+ * command, and maps them without their accessed bits set.  The extra
+ * pages are charged to RA, if it is not null.  Returns the number of
+ * pages read in, or 0 if PAGE could not be. */
+static size_t vm_swap_in_run(struct page *page, size_t window, struct readahead *ra)
+{
+	struct thread *curr = thread_current();
+	struct supplemental_page_table *spt = &curr->spt;
+	struct page *pages[SWAP_RA_MAX + 1];
+	size_t cnt = 1;
+
+	ASSERT(window <= SWAP_RA_MAX);
+
+	/* 가상 주소와 swap slot이 함께 이어지는 동안만 창을 늘린다. */
+	pages[0] = page;
+	while (cnt <= window)
+	{
+		struct page *next = spt_find_page(spt, page->va + cnt * PGSIZE);
+
+		if (next == NULL || VM_TYPE(next->operations->type) != VM_ANON || next->frame != NULL ||
+			next->anon.swap_index != page->anon.swap_index + (int)cnt)
+			break;
+		pages[cnt++] = next;
+	}
+
+	/* 프레임을 받아 매핑까지 해 둔다. 중간에 실패하면 거기서 창을 자른다.
+	 * 읽기 전이므로 잘라낸 페이지의 데이터는 아직 swap에 남아 있다. */
+	for (size_t i = 0; i < cnt; i++)
+	{
+		struct frame *frame = vm_get_frame();
+
+		if (frame != NULL)
+		{
+			frame_link(frame, pages[i]);
+			if (pml4_set_page(curr->pml4, pages[i]->va, frame->kva, pages[i]->writable))
+				continue;
+			page_set_frame(pages[i], NULL);
+			frame->page = NULL;
+			lock_acquire(&frame_lock);
+			vm_free_frame(frame);
+			lock_release(&frame_lock);
+		}
+		if (i == 0)
+			return 0;
+		cnt = i;
+		break;
+	}
+
+	anon_swap_in_cluster(pages, cnt);
+
+	lock_acquire(&frame_lock);
+	for (size_t i = 0; i < cnt; i++)
+	{
+		struct frame *frame = pages[i]->frame;
+
+		if (i > 0)
+		{
+			pml4_set_accessed(curr->pml4, pages[i]->va, false);
+			pages[i]->readahead = ra;
+		}
+		replace_insert(frame);
+		frame->pinned = false;
+	}
+	lock_release(&frame_lock);
+
+	if (ra != NULL)
+	{
+		ra->stats->pages += cnt - 1;
+		ra->start = page->va + PGSIZE;
+		ra->cnt = cnt - 1;
+	}
+	return cnt;
+}
+
+/* Returns where in its file the contents of PAGE are, if PAGE has to
+ * be read from a file: a page of an ELF segment or of a mapping that
+ * has never been loaded, or a mapped page that was evicted.  Returns
+ * NULL otherwise. */
+static struct aux_for_lazy_load *vm_page_file_aux(struct page *page)
+{
+	struct aux_for_lazy_load *aux;
+
+	switch (VM_TYPE(page->operations->type))
+	{
+	case VM_UNINIT:
+		aux = page->uninit.aux;
+		if (page->uninit.init != lazy_load_segment || aux == NULL ||
+			aux->load_file == NULL || aux->read_bytes == 0)
+			return NULL;
+		return aux;
+	case VM_FILE:
+		/* file 페이지는 초기화된 뒤에도 uninit 시절의 aux를 그대로 쓴다. */
+		return page->frame == NULL ? page->uninit.aux : NULL;
+	default:
+		return NULL;
+	}
+}
+
+/* Handles a major fault on PAGE, whose contents come from the file
+ * and offset in AUX, reading in a window of the pages after it with
+ * it (see vm_file_in_run()), so that a program does not take a
+ * fault, a seek and a small read for each page of its text. */
+/* 창 크기는 swap readahead처럼 vm_readahead_adapt()가 정한다. */
+static bool vm_claim_with_fault_around(struct page *page, struct aux_for_lazy_load *aux)
+{
+	struct readahead *ra = &thread_current()->spt.fault_around;
+
+	return vm_file_in_run(page, aux, vm_readahead_begin(ra, page), ra) > 0;
+}
+
+/* Reads in PAGE, whose contents come from the file and offset in AUX,
+ * together with up to WINDOW following virtual pages that are still
+ * to be read from the same file right after PAGE's contents, in one
+ * pass over the file, and maps them without their accessed bits set.
+ * The extra pages are charged to RA, if it is not null.  Returns the
+ * number of pages read in, or 0 if PAGE could not be. */
+static size_t vm_file_in_run(struct page *page, struct aux_for_lazy_load *aux, size_t window,
+							 struct readahead *ra)
+{
+	struct thread *curr = thread_current();
+	struct page *pages[FAULT_AROUND_MAX + 1];
+	void *kvas[FAULT_AROUND_MAX + 1];
+	size_t page_read_bytes[FAULT_AROUND_MAX + 1];
+	bool text[FAULT_AROUND_MAX + 1];
+	size_t cnt = 1;
+	off_t read_bytes;
+	bool loaded, success = true;
+
+	ASSERT(window <= FAULT_AROUND_MAX);
+
+	/* 섹터 단위로 읽을 수 없는 오프셋이면 한 페이지씩 읽는다. */
+	if (aux->offset % DISK_SECTOR_SIZE != 0)
+		return vm_do_claim_page(page) ? 1 : 0;
+
+	/* 앞 페이지가 꽉 차 있고, 파일에서도 바로 뒤를 읽는 페이지만 창에 넣는다.
+	 * 다른 프로세스가 이미 읽어 둔 실행 파일 페이지에서는 멈춘다.
+	 * 아직 건드리지 않은 페이지는 여기서 영역으로부터 만든다. */
+	pages[0] = page;
+	page_read_bytes[0] = aux->read_bytes;
+	read_bytes = aux->read_bytes;
+	lock_acquire(&frame_lock);
+	while (cnt <= window && read_bytes == (off_t)(cnt * PGSIZE))
+	{
+		struct page *next = spt_get_page(&curr->spt, page->va + cnt * PGSIZE);
+		struct aux_for_lazy_load *next_aux = next != NULL ? vm_page_file_aux(next) : NULL;
+
+		if (next_aux == NULL || next_aux->load_file != aux->load_file ||
+			next_aux->offset != aux->offset + (off_t)(cnt * PGSIZE) ||
+			(next->text != NULL && text_lookup(next->text) != NULL))
+			break;
+		page_read_bytes[cnt] = next_aux->read_bytes;
+		read_bytes += next_aux->read_bytes;
+		pages[cnt++] = next;
+	}
+	lock_release(&frame_lock);
+
+	/* 프레임을 받아 매핑까지 해 둔다. 중간에 실패하면 거기서 창을 자른다. */
+	for (size_t i = 0; i < cnt; i++)
+	{
+		struct frame *frame = vm_get_frame();
+
+		if (frame != NULL)
+		{
+			frame_link(frame, pages[i]);
+			if (pml4_set_page(curr->pml4, pages[i]->va, frame->kva, pages[i]->writable))
 			{
-				return false;
+				kvas[i] = frame->kva;
+				continue;
 			}
+			page_set_frame(pages[i], NULL);
+			frame->page = NULL;
+			lock_acquire(&frame_lock);
+			vm_free_frame(frame);
+			lock_release(&frame_lock);
 		}
+		if (i == 0)
+			return 0;
+		cnt = i;
+		read_bytes = 0;
+		for (size_t j = 0; j < cnt; j++)
+			read_bytes += page_read_bytes[j];
+		break;
+	}
+
+	/* 창 전체를 한 번에 읽는다. 못 읽었으면 각 페이지가 원래대로 제 몫을 읽는다. */
+	loaded = file_read_pages(aux->load_file, kvas, read_bytes, aux->offset) == read_bytes;
+	for (size_t i = 0; i < cnt; i++)
+	{
+		struct page *p = pages[i];
+		bool ok;
+
+		/* 처음 읽는 실행 파일 페이지면 다 읽은 뒤 공유 표에 넣는다. */
+		text[i] = p->text != NULL && VM_TYPE(p->operations->type) == VM_UNINIT;
+
+		if (!loaded)
+			ok = swap_in(p, kvas[i]);
 		else
 		{
-			return false;
+			memset(kvas[i] + page_read_bytes[i], 0, PGSIZE - page_read_bytes[i]);
+			ok = VM_TYPE(p->operations->type) != VM_UNINIT || uninit_initialize_loaded(p, kvas[i]);
 		}
+		text[i] = text[i] && ok;
+		if (i == 0)
+			success = ok;
 	}
-	return vm_do_claim_page(page);
+
+	lock_acquire(&frame_lock);
+	for (size_t i = 0; i < cnt; i++)
+	{
+		struct frame *frame = pages[i]->frame;
+
+		if (i > 0)
+		{
+			pml4_set_accessed(curr->pml4, pages[i]->va, false);
+			pages[i]->readahead = ra;
+		}
+		if (text[i])
+			text_insert(frame, pages[i]->text);
+		replace_insert(frame);
+		frame->pinned = false;
+	}
+	lock_release(&frame_lock);
+
+	if (ra != NULL)
+	{
+		ra->stats->pages += cnt - 1;
+		ra->start = page->va + PGSIZE;
+		ra->cnt = cnt - 1;
+	}
+	return success ? cnt : 0;
+}
+
+/* Brings in the pages of the current process in [ADDR, ADDR + LENGTH)
+ * that are not in memory but have their contents in a file or in
+ * swap, reading each run of them that is contiguous on disk with one
+ * command, as fault-around and swap readahead do.  Pages that start
+ * out as zeros are left to their first fault.  Used for
+ * MADV_WILLNEED and for mmap() with MAP_POPULATE. */
+void vm_prefetch(void *addr, size_t length)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	size_t cnt = DIV_ROUND_UP(length, PGSIZE);
+
+	for (size_t i = 0; i < cnt; i++)
+	{
+		void *va = addr + i * PGSIZE;
+		struct page *page = spt_find_page(spt, va);
+		size_t rest = cnt - i - 1;
+		struct aux_for_lazy_load *aux;
+		struct vma *vma;
+
+		/* 아직 만들지 않은 페이지는 파일에서 읽을 것일 때만 만든다. */
+		if (page == NULL && (vma = vma_find(spt, va)) != NULL && vma->file != NULL &&
+			(size_t)(va - vma->start) < vma->read_bytes)
+			page = spt_get_page(spt, va);
+		/* 앞에서 함께 읽은 페이지는 이미 프레임이 있으니 건너뛴다. */
+		if (page == NULL || page->frame != NULL)
+			continue;
+		if (vm_map_text(page))
+			continue;
+		if (VM_TYPE(page->operations->type) == VM_ANON && page->anon.swap_index != -1)
+			vm_stats.prefetched += vm_swap_in_run(page, rest < SWAP_RA_MAX ? rest : SWAP_RA_MAX, NULL);
+		else if ((aux = vm_page_file_aux(page)) != NULL)
+			vm_stats.prefetched += vm_file_in_run(page, aux, rest < FAULT_AROUND_MAX ? rest : FAULT_AROUND_MAX,
+												  NULL);
+	}
+}
+
+/* Throws away the contents of PAGE and frees its frame and swap slot,
+ * for MADV_DONTNEED.  A page of a mapping is written back first and
+ * read from its file again on the next fault; an anonymous page goes
+ * back to what it started as, a page of its executable or a page of
+ * zeros.  A page that is being evicted right now is left alone. */
+static void vm_discard_page(struct page *page)
+{
+	uint64_t *pml4 = page->owner->pml4;
+	struct frame *frame;
+
+	lock_acquire(&frame_lock);
+	frame = page->frame;
+	if (frame != NULL && frame->pinned)
+	{
+		lock_release(&frame_lock);
+		return;
+	}
+
+	switch (VM_TYPE(page->operations->type))
+	{
+	case VM_UNINIT:
+		if (page->zero_mapped)
+		{
+			pml4_clear_page(pml4, page->va);
+			page->zero_mapped = false;
+		}
+		break;
+	case VM_FILE:
+		if (frame == NULL)
+			break;
+		/* 고친 내용은 파일에 써 두고 프레임만 돌려준다. */
+		swap_out(page);
+		vm_free_frame(frame);
+		vm_stats.dropped++;
+		break;
+	case VM_ANON:
+		if (frame != NULL && frame->ref_cnt > 1)
+			frame_unshare(frame, page);
+		else if (frame != NULL)
+			vm_free_frame(frame);
+		else if (page->anon.swap_index == -1)
+			break;
+		anon_drop_swap_slot(page);
+		/* anon 페이지도 union에 uninit 시절의 init과 aux가 남아 있다. */
+		uninit_revert(page, page->anon.init, page->anon.type, page->anon.aux, anon_initializer);
+		vm_stats.dropped++;
+		break;
+	default:
+		break;
+	}
+	lock_release(&frame_lock);
+}
+
+/* Applies madvise() ADVICE to the pages of the current process in
+ * [ADDR, ADDR + LENGTH).  MADV_NORMAL, MADV_RANDOM and
+ * MADV_SEQUENTIAL are remembered in the areas holding the range,
+ * which are split at its ends, and change how much their faults read
+ * ahead; MADV_WILLNEED and MADV_DONTNEED act on the pages right away.
+ * Returns false if ADVICE is unknown or some page in the range is not
+ * mapped; the mapped ones still take it. */
+bool vm_madvise(void *addr, size_t length, int advice)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	void *end = addr + DIV_ROUND_UP(length, PGSIZE) * PGSIZE;
+	struct vma *vma;
+	bool success = true;
+
+	if (advice < MADV_NORMAL || advice > MADV_DONTNEED)
+		return false;
+
+	for (void *va = addr; va < end; va = vma->end)
+	{
+		vma = vma_lookup(spt, va);
+		if (vma == NULL || vma->start >= end)
+		{
+			success = false;
+			break;
+		}
+		/* 영역 사이의 빈 곳은 건너뛴다. */
+		if (vma->start > va)
+		{
+			success = false;
+			va = vma->start;
+		}
+
+		if (advice == MADV_DONTNEED)
+		{
+			/* 아직 만들지 않은 페이지는 버릴 것도 없다. */
+			void *last = vma->end < end ? vma->end : end;
+
+			for (struct page *page = spt_next_page(spt, va, last); page != NULL;
+				 page = spt_next_page(spt, page->va + PGSIZE, last))
+				vm_discard_page(page);
+		}
+		else if (advice != MADV_WILLNEED)
+		{
+			/* 범위 밖의 페이지는 advice를 받지 않도록 범위 끝에서 영역을 나눈다. */
+			if (vma->start < va && (vma = vma_split(spt, vma, va)) == NULL)
+				return false;
+			if (end < vma->end && vma_split(spt, vma, end) == NULL)
+				return false;
+			vma->advice = advice;
+		}
+	}
+
+	if (advice == MADV_WILLNEED)
+		vm_prefetch(addr, length);
+	return success;
+}
+
+/* Starts timing an exec in the current process, until the new
+ * program makes its first system call (see vm_exec_end()). */
+void vm_exec_begin(void)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+
+	spt->exec_start = timer_ticks();
+	spt->exec_faults = 0;
+}
+
+/* Called on every system call.  The first one after an exec comes
+ * from the new program once it is running, normally from main(), so
+ * the time and faults spent getting there are added to the exec
+ * totals in vm_stats. */
+void vm_exec_end(void)
+{
+	struct supplemental_page_table *spt = &thread_current()->spt;
+
+	if (spt->exec_start == -1)
+		return;
+	vm_stats.execs++;
+	vm_stats.exec_ticks += timer_elapsed(spt->exec_start);
+	vm_stats.exec_faults += spt->exec_faults;
+	spt->exec_start = -1;
+}
+
+/* Maps PAGE, a page of a read-only ELF segment that it has not
+ * loaded yet, to the frame in which another process already loaded
+ * the same page of the same executable, if there is one.  Returns
+ * true if it did. */
+static bool vm_map_text(struct page *page)
+{
+	struct frame *frame;
+	bool mapped = false;
+
+	if (page->text == NULL || VM_TYPE(page->operations->type) != VM_UNINIT)
+		return false;
+
+	lock_acquire(&frame_lock);
+	frame = text_lookup(page->text);
+	if (frame != NULL && pml4_set_page(page->owner->pml4, page->va, frame->kva, false))
+	{
+		uninit_initialize_loaded(page, frame->kva);
+		/* 한 프레임을 공유하는 페이지들은 swap slot도 같아야 한다. */
+		anon_share_swap_slot(page, frame->page);
+		page_set_frame(page, frame);
+		page->share_next = frame->page;
+		frame->page = page;
+		frame->ref_cnt++;
+		vm_stats.text_shared++;
+		mapped = true;
+	}
+	lock_release(&frame_lock);
+	return mapped;
+}
+
+/* Evicts FRAME, which holds a page of an executable, without writing
+ * it anywhere: every page that maps it goes back to being an uninit
+ * page and is read from the file again on its next fault.  Called
+ * with frame_lock held. */
+static void vm_drop_text(struct frame *frame)
+{
+	for (struct page *page = frame->page; page != NULL; page = page->share_next)
+	{
+		uint64_t *pml4 = page->owner->pml4;
+
+		if (pml4 != NULL)
+			pml4_clear_page(pml4, page->va);
+		anon_drop_swap_slot(page);
+		uninit_revert(page, lazy_load_segment, VM_ANON, page->text, anon_initializer);
+	}
+	vm_stats.text_dropped++;
+}
+
+/* Returns true if PAGE has never been brought in and will start out
+ * all zeros: a stack or other anonymous page, or a page that is
+ * entirely bss. */
+static bool vm_page_is_zero_fill(struct page *page)
+{
+	struct aux_for_lazy_load *aux;
+
+	if (VM_TYPE(page->operations->type) != VM_UNINIT || VM_TYPE(page->uninit.type) != VM_ANON)
+		return false;
+	aux = page->uninit.aux;
+	return aux == NULL || aux->read_bytes == 0;
+}
+
+/* Returns true if bringing in PAGE takes disk I/O: it was swapped
+ * out, or its contents come from a file. */
+static bool vm_fault_is_major(struct page *page)
+{
+	switch (VM_TYPE(page->operations->type))
+	{
+	case VM_UNINIT:
+	{
+		struct aux_for_lazy_load *aux = page->uninit.aux;
+		return aux != NULL && aux->load_file != NULL && aux->read_bytes > 0;
+	}
+	case VM_ANON:
+		return page->anon.swap_index != -1;
+	default:
+		return true;
+	}
+}
+
+/* Prints fault and eviction counts. */
+void vm_print_stats(void)
+{
+	printf("VM: %zu major faults, %zu minor faults (%zu zero-page), %zu evictions (%s)\n",
+		   vm_stats.major_faults, vm_stats.minor_faults, vm_stats.zero_maps,
+		   vm_stats.evictions, replace_name());
+	printf("Readahead: %zu pages, %zu hits, %zu misses\n",
+		   vm_stats.swap_ra.pages, vm_stats.swap_ra.hits, vm_stats.swap_ra.misses);
+	printf("Fault-around: %zu pages, %zu hits, %zu misses\n",
+		   vm_stats.fault_around.pages, vm_stats.fault_around.hits, vm_stats.fault_around.misses);
+	printf("Text: %zu faults mapped shared executable pages, %zu frames dropped on eviction\n",
+		   vm_stats.text_shared, vm_stats.text_dropped);
+	printf("Exec: %zu programs reached their first system call in %lld ticks and %zu faults\n",
+		   vm_stats.execs, vm_stats.exec_ticks, vm_stats.exec_faults);
+	printf("Advice: %zu pages prefetched, %zu dropped, %zu deactivated behind sequential reads\n",
+		   vm_stats.prefetched, vm_stats.dropped, vm_stats.deactivated);
+	printf("Reclaim: %zu direct reclaims freed %zu frames, kswapd woke %zu times and freed %zu frames\n",
+		   vm_stats.direct_reclaims, vm_stats.direct_pages, vm_stats.kswapd_wakeups,
+		   vm_stats.kswapd_pages);
+	printf("Fork: %zu forks in %lld ticks, %zu frames shared, %zu copied on write, %zu reused\n",
+		   vm_stats.forks, vm_stats.fork_ticks, vm_stats.cow_shared, vm_stats.cow_copies,
+		   vm_stats.cow_reuses);
+	size_t huge_tries = vm_stats.huge_faults + vm_stats.huge_fallbacks;
+	printf("Huge: %zu of %zu eligible faults mapped 2 MB pages (%zu%% hit rate), %zu split\n",
+		   vm_stats.huge_faults, huge_tries,
+		   huge_tries > 0 ? vm_stats.huge_faults * 100 / huge_tries : 0, pml4_huge_splits());
+	anon_print_stats();
+	ksm_print_stats();
+	rss_print_stats();
 }
 
 /* Free the page.
@@ -279,7 +1621,7 @@ void vm_dealloc_page(struct page *page)
 /* Claims the page to allocate va */
 bool vm_claim_page(void *va UNUSED)
 {
-	struct page *page = spt_find_page(&thread_current()->spt, va);
+	struct page *page = spt_get_page(&thread_current()->spt, va);
 
 	if (!page)
 	{
@@ -298,62 +1640,145 @@ vm_do_claim_page(struct page *page)
 		return false;
 	}
 	struct frame *frame = vm_get_frame();
+	if (frame == NULL)
+	{
+		return false;
+	}
 
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	frame_link(frame, page);
 
 	/* 페이지의 VA를 프레임의 PA에 매핑하기 위해 PTE insert */
-	if (!pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable))
+	if (!pml4_set_page(page->owner->pml4, page->va, frame->kva, page->writable))
 	{
+		page_set_frame(page, NULL);
+		frame->page = NULL;
+		lock_acquire(&frame_lock);
+		vm_free_frame(frame);
+		lock_release(&frame_lock);
 		return false;
 	}
+	page->zero_mapped = false;
+	lock_acquire(&frame_lock);
+	replace_insert(frame);
+	lock_release(&frame_lock);
 
-	return swap_in(page, frame->kva);
+	bool loading_text = page->text != NULL && VM_TYPE(page->operations->type) == VM_UNINIT;
+	bool success = swap_in(page, frame->kva);
+	if (success && loading_text)
+	{
+		lock_acquire(&frame_lock);
+		text_insert(frame, page->text);
+		lock_release(&frame_lock);
+	}
+	frame->pinned = false;
+	return success;
 }
 
 /* Initialize new supplemental page table */
 void supplemental_page_table_init(struct supplemental_page_table *spt UNUSED)
 {
-	hash_init(&spt->vm, page_hash, page_less, NULL);
+	spt->pages = NULL; /* 표는 첫 페이지를 넣을 때 만든다 (vm/spt.c) */
+	vma_init(spt);
+	vm_readahead_init(&spt->swap_ra, SWAP_RA_MAX, &vm_stats.swap_ra);
+	vm_readahead_init(&spt->fault_around,
+					  fault_around_pages < FAULT_AROUND_MAX ? fault_around_pages : FAULT_AROUND_MAX,
+					  &vm_stats.fault_around);
+	spt->exec_start = -1;
+	spt->exec_faults = 0;
+	spt->rss = 0;
+	spt->rss_peak = 0;
+	spt->rss_reclaims = 0;
+	spt->reclaim_cursor = NULL;
+	spt->ws_tally = 0;
+	spt->ws_pages = 0;
+	spt->ws_peak = 0;
+	spt->ws_samples = 0;
+	spt->major_faults = 0;
+	spt->minor_faults = 0;
 }
 
 /* Copy supplemental page table from src to dst */
+/* anonymous page는 복사하지 않고 부모와 공유한다 (copy-on-write). */
 bool supplemental_page_table_copy(struct supplemental_page_table *dst UNUSED,
 								  struct supplemental_page_table *src UNUSED)
 {
-	struct hash_iterator i;
 	struct page *parent_page;
 	struct thread *child_thread = thread_current();
-	bool success = false;
+	int64_t start = timer_ticks();
+	/* 영역을 먼저 옮겨야 부모가 아직 건드리지 않은 페이지도 자식이 fault로 만든다. */
+	bool success = vma_copy(dst, src);
 
-	hash_first(&i, &src->vm);
-	while (hash_next(&i))
+	for (parent_page = spt_next_page(src, NULL, (void *)KERN_BASE); success && parent_page != NULL;
+		 parent_page = spt_next_page(src, parent_page->va + PGSIZE, (void *)KERN_BASE))
 	{
-		parent_page = hash_entry(hash_cur(&i), struct page, hash_elem);
 
 		success = vm_alloc_page_with_initializer(parent_page->uninit.type,
 												 parent_page->va,
 												 parent_page->writable,
 												 parent_page->uninit.init,
 												 parent_page->uninit.aux);
+		if (!success)
+			break;
 		struct page *child_page = spt_find_page(&child_thread->spt, parent_page->va);
+		child_page->text = parent_page->text;
 
-		/* anonymous page OR file backed page */
-		if (parent_page->frame)
+		if (VM_TYPE(parent_page->operations->type) == VM_ANON)
+			success = vm_share_anon_page(child_page, parent_page);
+		/* file backed page */
+		else if (parent_page->frame)
 		{
 			success = vm_do_claim_page(child_page);
-			memcpy(child_page->frame->kva, parent_page->frame->kva, PGSIZE);
+			if (success)
+				memcpy(child_page->frame->kva, parent_page->frame->kva, PGSIZE);
 		}
 	}
+
+	vm_stats.forks++;
+	vm_stats.fork_ticks += timer_elapsed(start);
 	return success;
 }
 
-void *
-page_destroy(struct hash_elem *hash_elem, void *aux UNUSED)
+/* Makes CHILD, a new page of the current process, start out with
+ * the contents of the anonymous PARENT without copying them.  A
+ * resident frame is mapped read-only into both processes until one
+ * of them writes to it (see vm_handle_wp()); a swapped-out page
+ * shares its swap slot. */
+static bool vm_share_anon_page(struct page *child, struct page *parent)
 {
-	struct page *page = hash_entry(hash_elem, struct page, hash_elem);
-	vm_dealloc_page(page);
+	uint64_t *pml4 = parent->owner->pml4;
+	struct frame *frame;
+	bool success = true;
+
+	/* PARENT의 init()은 이미 실행되었으니 CHILD는 곧바로 anon page가 된다. */
+	anon_initializer(child, child->uninit.type, NULL);
+
+	lock_acquire(&frame_lock);
+	vm_wait_evicted(parent);
+	frame = parent->frame;
+	if (frame != NULL)
+	{
+		/* fork 전에 고친 페이지라면 swap cache에 남은 사본은 이제 틀리다. */
+		if (pml4_is_dirty(pml4, parent->va))
+			anon_drop_swap_slot(parent);
+
+		bool accessed = pml4_is_accessed(pml4, parent->va);
+		success = pml4_set_page(child->owner->pml4, child->va, frame->kva, false);
+		if (success)
+		{
+			pml4_set_page(pml4, parent->va, frame->kva, false);
+			pml4_set_accessed(pml4, parent->va, accessed);
+			page_set_frame(child, frame);
+			child->share_next = frame->page;
+			frame->page = child;
+			frame->ref_cnt++;
+			vm_stats.cow_shared++;
+		}
+	}
+	if (success)
+		anon_share_swap_slot(child, parent);
+	lock_release(&frame_lock);
+	return success;
 }
 
 /* Free the resource hold by the supplemental page table */
@@ -361,5 +1786,12 @@ void supplemental_page_table_kill(struct supplemental_page_table *spt UNUSED)
 {
 	/* Destroy all the supplemental_page_table hold by thread and
 	 * writeback all the modified contents to the storage. */
-	hash_destroy(&spt->vm, page_destroy);
+	/* 큰 페이지는 쪼개지 않고 매핑을 통째로 지운 뒤 프레임을 하나씩 돌려준다. */
+	uint64_t *pml4 = thread_current()->pml4;
+	for (struct vma *vma = vma_first(spt); pml4 != NULL && vma != NULL; vma = vma_next(vma))
+		for (void *va = (void *)ROUND_UP((uintptr_t)vma->start, HPAGE_SIZE); va + HPAGE_SIZE <= vma->end;
+			 va += HPAGE_SIZE)
+			pml4_clear_huge_page(pml4, va);
+	spt_destroy_pages(spt);
+	vma_destroy(spt);
 }
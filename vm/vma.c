@@ -0,0 +1,166 @@
+/* vma.c: Virtual memory areas.
+ *
+ * load_segment(), do_mmap() and setup_stack() describe each range of
+ * a process's address space with one struct vma instead of making a
+ * struct page for every page of it up front.  The areas of a process
+ * are kept in a red-black tree ordered by start address, so that
+ * the area holding a faulting address is found in O(log n) time, and
+ * spt_get_page() makes the struct page for a page only when it is
+ * first touched. */
+
+#include "vm/vma.h"
+#include <debug.h>
+#include <syscall-nr.h>
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+static bool vma_less(const struct rb_elem *a_, const struct rb_elem *b_, void *aux UNUSED)
+{
+	const struct vma *a = rb_entry(a_, struct vma, elem);
+	const struct vma *b = rb_entry(b_, struct vma, elem);
+
+	return a->start < b->start;
+}
+
+/* Returns the area of SPT with the greatest start address not above
+ * VA, or NULL if there is none. */
+static struct vma *vma_floor(struct supplemental_page_table *spt, const void *va)
+{
+	struct vma key = {.start = (void *)va};
+	struct rb_elem *e;
+
+	e = rb_floor(&spt->vmas, &key.elem);
+	return e != NULL ? rb_entry(e, struct vma, elem) : NULL;
+}
+
+/* Initializes SPT's tree of areas. */
+void vma_init(struct supplemental_page_table *spt)
+{
+	rb_init(&spt->vmas, vma_less, NULL);
+}
+
+/* Adds an area [START, END) of TYPE pages to SPT.  Its first
+ * READ_BYTES bytes are read from FILE at OFFSET, the rest are zeros.
+ * Returns the new area, or NULL if it overlaps one that is already
+ * there or memory runs out. */
+struct vma *vma_add(struct supplemental_page_table *spt, void *start, void *end,
+					enum vm_type type, bool writable, struct file *file, off_t offset,
+					size_t read_bytes)
+{
+	struct vma *next;
+	struct vma *vma;
+
+	ASSERT(pg_ofs(start) == 0 && pg_ofs(end) == 0);
+	ASSERT(start < end);
+
+	/* 겹치는 영역이 있으면 그것이 END보다 먼저 시작한다. */
+	next = vma_lookup(spt, start);
+	if (next != NULL && next->start < end)
+		return NULL;
+
+	vma = malloc(sizeof *vma);
+	if (vma == NULL)
+		return NULL;
+	vma->start = start;
+	vma->end = end;
+	vma->type = type;
+	vma->writable = writable;
+	vma->file = file;
+	vma->offset = offset;
+	vma->read_bytes = read_bytes;
+	vma->advice = MADV_NORMAL;
+	rb_insert(&spt->vmas, &vma->elem);
+	return vma;
+}
+
+/* Removes VMA from SPT and frees it.  The pages made from it must
+ * already be gone. */
+void vma_remove(struct supplemental_page_table *spt, struct vma *vma)
+{
+	rb_remove(&spt->vmas, &vma->elem);
+	free(vma);
+}
+
+/* Returns the area of SPT that holds VA, or NULL. */
+struct vma *vma_find(struct supplemental_page_table *spt, const void *va)
+{
+	struct vma *vma = vma_floor(spt, va);
+
+	return vma != NULL && va < vma->end ? vma : NULL;
+}
+
+/* Returns the area of SPT that holds VA or, if none does, the first
+ * one above it.  Returns NULL if there is neither. */
+struct vma *vma_lookup(struct supplemental_page_table *spt, const void *va)
+{
+	struct vma *vma = vma_floor(spt, va);
+
+	if (vma != NULL && va < vma->end)
+		return vma;
+	return vma != NULL ? vma_next(vma) : vma_first(spt);
+}
+
+/* Splits VMA at VA, a page boundary inside it, into two areas.  VMA
+ * keeps the pages below VA and the new area, which is returned,
+ * gets the rest.  Returns NULL if memory runs out. */
+struct vma *vma_split(struct supplemental_page_table *spt, struct vma *vma, void *va)
+{
+	size_t below = va - vma->start;
+	struct vma *upper;
+
+	ASSERT(pg_ofs(va) == 0 && vma->start < va && va < vma->end);
+
+	upper = malloc(sizeof *upper);
+	if (upper == NULL)
+		return NULL;
+	*upper = *vma;
+	upper->start = va;
+	upper->offset = vma->offset + below;
+	upper->read_bytes = vma->read_bytes > below ? vma->read_bytes - below : 0;
+	vma->end = va;
+	vma->read_bytes = vma->read_bytes < below ? vma->read_bytes : below;
+	rb_insert(&spt->vmas, &upper->elem);
+	return upper;
+}
+
+/* Returns the lowest area of SPT, or NULL if it has none. */
+struct vma *vma_first(struct supplemental_page_table *spt)
+{
+	struct rb_elem *e = rb_first(&spt->vmas);
+
+	return e != NULL ? rb_entry(e, struct vma, elem) : NULL;
+}
+
+/* Returns the area after VMA, or NULL if it is the last. */
+struct vma *vma_next(struct vma *vma)
+{
+	struct rb_elem *e = rb_next(&vma->elem);
+
+	return e != NULL ? rb_entry(e, struct vma, elem) : NULL;
+}
+
+/* Gives DST a copy of each area of SRC, for fork.  The files are
+ * shared, as the pages made from them share their aux. */
+bool vma_copy(struct supplemental_page_table *dst, struct supplemental_page_table *src)
+{
+	for (struct vma *vma = vma_first(src); vma != NULL; vma = vma_next(vma))
+	{
+		struct vma *copy = vma_add(dst, vma->start, vma->end, vma->type, vma->writable,
+								   vma->file, vma->offset, vma->read_bytes);
+
+		if (copy == NULL)
+			return false;
+		copy->advice = vma->advice;
+	}
+	return true;
+}
+
+/* Frees every area of SPT. */
+void vma_destroy(struct supplemental_page_table *spt)
+{
+	struct vma *vma;
+
+	while ((vma = vma_first(spt)) != NULL)
+		vma_remove(spt, vma);
+}
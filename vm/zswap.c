@@ -0,0 +1,186 @@
+/* zswap.c: A compressed in-memory tier in front of the swap disk.
+ *
+ * Swapped-out anonymous pages still get a swap slot, but
+ * zswap_store() first tries to keep the page, compressed, in memory
+ * under that slot, so that neither swap-out nor the next swap-in
+ * touches the disk.  The pool is malloc()ed from the kernel pool and
+ * capped at zswap_pool_pages pages.  When a store would go over the
+ * cap, the oldest entries are written to their slots on the swap
+ * disk and freed. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <list.h>
+#include <lz.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A compressed page. */
+struct zswap_entry
+{
+	size_t slot;		   /* 이 페이지의 swap slot */
+	size_t size;		   /* data의 바이트 수 */
+	struct list_elem elem; /* lru */
+	uint8_t data[];
+};
+
+/* malloc()의 가장 큰 블록. 이보다 크면 페이지 하나를 통째로 쓰므로,
+ * 헤더와 함께 여기에 들어가지 않는 페이지는 그냥 디스크로 보낸다. */
+#define ZSWAP_BLOCK_MAX 1024
+#define ZSWAP_DATA_MAX (ZSWAP_BLOCK_MAX - sizeof(struct zswap_entry))
+
+#define SECTORS_PER_PAGE (PGSIZE / DISK_SECTOR_SIZE)
+
+size_t zswap_pool_pages;
+
+static struct disk *swap_disk;
+static struct zswap_entry **entries; /* slot 번호로 찾는 항목, 없으면 NULL */
+static struct list lru;				 /* 오래 전에 저장된 항목부터 */
+static size_t pool_bytes;			 /* 항목들이 차지한 malloc 블록 크기의 합 */
+
+/* 위의 모든 것과 아래 작업 버퍼를 보호한다. */
+static struct lock zswap_lock;
+static uint16_t work[LZ_WORK_SIZE / sizeof(uint16_t)];
+static uint8_t cbuf[ZSWAP_DATA_MAX]; /* 압축 결과 */
+static uint8_t pbuf[PGSIZE];		 /* 디스크로 되돌려 쓸 때 푼 페이지 */
+
+/* Counters, for zswap_print_stats(). */
+static size_t stored;	   /* 풀에 넣은 페이지 수 */
+static size_t rejected;	   /* 잘 줄지 않아 디스크로 보낸 페이지 수 */
+static size_t written_back; /* 풀이 차서 디스크로 옮긴 페이지 수 */
+static size_t loaded;	   /* 풀에서 바로 읽어 들인 페이지 수 */
+
+/* Returns the size of the malloc() block that holds N bytes. */
+static size_t block_size(size_t n)
+{
+	size_t size = 16;
+
+	while (size < n)
+		size *= 2;
+	return size;
+}
+
+/* Sets up the pool in front of the SLOT_CNT page slots of DISK, if
+ * the -zswap option asked for one. */
+void zswap_init(struct disk *disk, size_t slot_cnt)
+{
+	swap_disk = disk;
+	list_init(&lru);
+	lock_init(&zswap_lock);
+	if (zswap_pool_pages > 0)
+	{
+		entries = calloc(slot_cnt, sizeof *entries);
+		if (entries == NULL)
+			zswap_pool_pages = 0;
+	}
+}
+
+static void zswap_free(struct zswap_entry *e)
+{
+	entries[e->slot] = NULL;
+	list_remove(&e->elem);
+	pool_bytes -= block_size(sizeof *e + e->size);
+	free(e);
+}
+
+/* Writes the page in E to its slot on the swap disk and frees E. */
+static void zswap_writeback(struct zswap_entry *e)
+{
+	const void *sectors[SECTORS_PER_PAGE];
+	size_t size = lz_decompress(e->data, e->size, pbuf, PGSIZE);
+
+	ASSERT(size == PGSIZE);
+	for (size_t i = 0; i < SECTORS_PER_PAGE; i++)
+		sectors[i] = pbuf + i * DISK_SECTOR_SIZE;
+	disk_writev(swap_disk, e->slot * SECTORS_PER_PAGE, sectors, SECTORS_PER_PAGE);
+	zswap_free(e);
+	written_back++;
+}
+
+/* Keeps the page at KVA compressed in the pool as the contents of
+ * swap slot SLOT.  Returns false if the pool is off or the page does
+ * not compress well enough, in which case it must go to the disk. */
+bool zswap_store(size_t slot, const void *kva)
+{
+	struct zswap_entry *e = NULL;
+	size_t max = zswap_pool_pages * PGSIZE;
+
+	if (zswap_pool_pages == 0)
+		return false;
+
+	lock_acquire(&zswap_lock);
+	ASSERT(entries[slot] == NULL);
+	size_t size = lz_compress(kva, PGSIZE, cbuf, sizeof cbuf, work);
+	if (size > 0)
+	{
+		size_t bytes = block_size(sizeof *e + size);
+
+		/* 자리가 모자라면 가장 오래된 것부터 디스크로 내보낸다. */
+		while (pool_bytes + bytes > max && !list_empty(&lru))
+			zswap_writeback(list_entry(list_front(&lru), struct zswap_entry, elem));
+		if (pool_bytes + bytes <= max)
+			e = malloc(sizeof *e + size);
+		if (e != NULL)
+		{
+			e->slot = slot;
+			e->size = size;
+			memcpy(e->data, cbuf, size);
+			entries[slot] = e;
+			list_push_back(&lru, &e->elem);
+			pool_bytes += bytes;
+			stored++;
+		}
+	}
+	if (e == NULL)
+		rejected++;
+	lock_release(&zswap_lock);
+	return e != NULL;
+}
+
+/* Decompresses the contents of swap slot SLOT into KVA, if they are
+ * in the pool, and returns true.  Returns false if they have to be
+ * read from the disk.  The entry stays until the slot is freed. */
+bool zswap_load(size_t slot, void *kva)
+{
+	struct zswap_entry *e;
+
+	if (zswap_pool_pages == 0)
+		return false;
+
+	lock_acquire(&zswap_lock);
+	e = entries[slot];
+	if (e != NULL)
+	{
+		size_t size = lz_decompress(e->data, e->size, kva, PGSIZE);
+		ASSERT(size == PGSIZE);
+		loaded++;
+	}
+	lock_release(&zswap_lock);
+	return e != NULL;
+}
+
+/* Drops whatever the pool holds for swap slot SLOT, which has just
+ * been freed. */
+void zswap_invalidate(size_t slot)
+{
+	if (zswap_pool_pages == 0)
+		return;
+
+	lock_acquire(&zswap_lock);
+	if (entries[slot] != NULL)
+		zswap_free(entries[slot]);
+	lock_release(&zswap_lock);
+}
+
+/* Prints pool usage counts. */
+void zswap_print_stats(void)
+{
+	if (zswap_pool_pages > 0)
+		printf("Zswap: %zu pages stored, %zu incompressible, %zu written back, "
+			   "%zu loaded, %zu bytes in pool\n",
+			   stored, rejected, written_back, loaded, pool_bytes);
+}